@@ -1,7 +1,19 @@
 #include "pch.h"
+#include <chrono>
+#include <string>
+#include <thread>
 #include "CppUnitTest.h"
+#include "../BigNum/BarrettReducer.h"
 #include "../BigNum/BigNum.h"
+#include "../BigNum/BigNumAccumulator.h"
+#include "../BigNum/DigitArena.h"
+#include "../BigNum/DigitKernels.h"
+#include "../BigNum/FixedBigNum.h"
+#include "../BigNum/Gcd.h"
+#include "../BigNum/MontgomeryContext.h"
+#include "../BigNum/Mpn.h"
 #include "../BigNum/RsaMath.h"
+#include "../BigNum/SlidingWindow.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -75,7 +87,7 @@ namespace BigNumTests
         TEST_METHOD( TestLeftShift )
         {
             BigNum a( std::vector<uint8_t>{ 1 } );
-            a <<= 34;
+            a <<= DigitBits + 3;
             Assert::IsTrue( a.numberDigits() == 2 );
             Assert::IsTrue( a.getDigit( 0 ) == 0 );
             Assert::IsTrue( a.getDigit( 1 ) == 8 );
@@ -85,13 +97,13 @@ namespace BigNumTests
         TEST_METHOD( TestRightShift )
         {
             BigNum a( std::vector<uint8_t>{ 1 } );
-            a <<= 34;
+            a <<= DigitBits + 3;
             Assert::IsTrue( a.numberDigits() == 2 );
             Assert::IsTrue( a.getDigit( 0 ) == 0 );
             Assert::IsTrue( a.getDigit( 1 ) == 8 );
             Assert::IsFalse( a.isNegative() );
 
-            a >>= 32;
+            a >>= DigitBits + 1;
             Assert::IsTrue( a.numberDigits() == 1 );
             Assert::IsTrue( a.getDigit( 0 ) == 4 );
             Assert::IsFalse( a.isNegative() );
@@ -101,7 +113,7 @@ namespace BigNumTests
         {
             const BigNum a( std::vector<uint8_t>{ 1 } );
             BigNum b( std::vector<uint8_t>{ 1 } );
-            b <<= 31;
+            b <<= DigitBits;
 
             BigNum c = a + b;
             Assert::IsTrue( c.numberDigits() == 2 );
@@ -109,7 +121,7 @@ namespace BigNumTests
             Assert::IsTrue( c.getDigit( 1 ) == 1 );
             Assert::IsFalse( c.isNegative() );
 
-            c.mod2b( 31 );
+            c.mod2b( DigitBits );
             Assert::IsTrue( c.numberDigits() == 1 );
             Assert::IsTrue( c.getDigit( 0 ) == 1 );
             Assert::IsFalse( c.isNegative() );
@@ -130,7 +142,7 @@ namespace BigNumTests
         {
             BigNum a( std::vector<uint8_t>{ 2 } );
             BigNum b( std::vector<uint8_t>{ 2 } );
-            b <<= 31;
+            b <<= DigitBits;
 
             Assert::IsTrue( b.numberDigits() == 2 );
             Assert::IsTrue( b.getDigit( 0 ) == 0 );
@@ -144,14 +156,334 @@ namespace BigNumTests
             Assert::IsFalse( a.isNegative() );
         }
 
+        TEST_METHOD( TestMultiplyAllOnes )
+        {
+            // a = 2^n - 1 maximizes every partial product, and a^2 = a * 2^n - a.
+            const size_t numberBytes = 200;
+            const BigNum a( std::vector<uint8_t>( numberBytes, 0xff ) );
+
+            BigNum expected( a );
+            expected <<= 8 * numberBytes;
+            expected -= a;
+
+            BigNum actual( a );
+            actual *= a;
+            Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+        }
+
+        TEST_METHOD( TestKaratsubaMultiply )
+        {
+            std::vector<uint8_t> aBytes( 700 );
+            std::vector<uint8_t> bBytes( 500 );
+            for( size_t iByte = 0; iByte < aBytes.size(); ++iByte )
+                aBytes[iByte] = static_cast<uint8_t>(iByte * 37 + 11);
+            for( size_t iByte = 0; iByte < bBytes.size(); ++iByte )
+                bBytes[iByte] = static_cast<uint8_t>(iByte * 91 + 5);
+
+            BigNum a( aBytes );
+            const BigNum b( bBytes );
+            a.negate();
+
+            // Compute the same products once with only the baseline multiplier and once with
+            // Karatsuba recursing down to small operands.
+            const size_t oldCutoff = KaratsubaMultiplyCutoff;
+            KaratsubaMultiplyCutoff = SIZE_MAX;
+            BigNum expected( a );
+            expected *= b;
+            const BigNum expectedSquare( b * b );
+
+            KaratsubaMultiplyCutoff = 8;
+            BigNum actual( a );
+            actual *= b;
+            const BigNum actualSquare( b * b );
+            KaratsubaMultiplyCutoff = oldCutoff;
+
+            Assert::IsTrue( actual.isNegative() );
+            Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+            Assert::IsTrue( expectedSquare.compare( actualSquare ) == Comparison::Equal );
+        }
+
+        TEST_METHOD( TestToomMultiply )
+        {
+            std::vector<uint8_t> aBytes( 1200 );
+            std::vector<uint8_t> bBytes( 900 );
+            for( size_t iByte = 0; iByte < aBytes.size(); ++iByte )
+                aBytes[iByte] = static_cast<uint8_t>(iByte * 53 + 7);
+            for( size_t iByte = 0; iByte < bBytes.size(); ++iByte )
+                bBytes[iByte] = static_cast<uint8_t>(255 - iByte * 29);
+
+            const BigNum a( aBytes );
+            const BigNum b( bBytes );
+
+            const size_t oldKaratsubaCutoff = KaratsubaMultiplyCutoff;
+            const size_t oldToomCutoff = ToomMultiplyCutoff;
+            KaratsubaMultiplyCutoff = SIZE_MAX;
+            ToomMultiplyCutoff = SIZE_MAX;
+            const BigNum expected( a * b );
+
+            // Toom-3 all the way down, and then Toom-3 on top of Karatsuba.
+            ToomMultiplyCutoff = 9;
+            const BigNum toomOnly( a * b );
+            ToomMultiplyCutoff = 60;
+            KaratsubaMultiplyCutoff = 8;
+            const BigNum mixed( a * b );
+            KaratsubaMultiplyCutoff = oldKaratsubaCutoff;
+            ToomMultiplyCutoff = oldToomCutoff;
+
+            Assert::IsTrue( expected.compare( toomOnly ) == Comparison::Equal );
+            Assert::IsTrue( expected.compare( mixed ) == Comparison::Equal );
+        }
+
+        TEST_METHOD( TestNttMultiply )
+        {
+            // Runs of b - 1 digits give the largest convolution coefficients, which is where an
+            // inexact recombination would show up first.
+            std::vector<uint8_t> aBytes( 5000 );
+            std::vector<uint8_t> bBytes( 3100 );
+            for( size_t iByte = 0; iByte < aBytes.size(); ++iByte )
+                aBytes[iByte] = iByte < 2000 ? 0xff : static_cast<uint8_t>(iByte * 53 + 7);
+            for( size_t iByte = 0; iByte < bBytes.size(); ++iByte )
+                bBytes[iByte] = iByte % 1000 < 700 ? 0xff : static_cast<uint8_t>(255 - iByte * 29);
+
+            const BigNum a( aBytes );
+            const BigNum b( bBytes );
+
+            const size_t oldNttCutoff = NttMultiplyCutoff;
+            NttMultiplyCutoff = SIZE_MAX;
+            const BigNum expectedProduct( a * b );
+            const BigNum expectedSquare( square( a ) );
+            BigNum x;
+            BigNum y;
+            BigNum expectedSmall;
+            x = 12345;
+            y = 678;
+            expectedSmall = 12345 * 678;
+
+            NttMultiplyCutoff = 1;
+            const BigNum product( a * b );
+            const BigNum squared( square( a ) );
+            const BigNum small( x * y );
+            NttMultiplyCutoff = oldNttCutoff;
+
+            Assert::IsTrue( expectedProduct.compare( product ) == Comparison::Equal );
+            Assert::IsTrue( expectedSquare.compare( squared ) == Comparison::Equal );
+            Assert::IsTrue( small.compare( expectedSmall ) == Comparison::Equal );
+        }
+
+        // A benchmark rather than a unit test, so it only runs when asked for explicitly: it takes
+        // several seconds and changes the multiplication cutoffs while it runs.
+        BEGIN_TEST_METHOD_ATTRIBUTE( TestNttMultiplyCrossover )
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+
+        TEST_METHOD( TestNttMultiplyCrossover )
+        {
+            // Times the baseline multiplier against the NTT multiplier on balanced products of
+            // increasing size and logs where the NTT overtakes it.
+            auto timeProduct = []( const BigNum & a, const BigNum & b, size_t nttCutoff,
+                BigNum & product )
+            {
+                const size_t oldKaratsubaCutoff = KaratsubaMultiplyCutoff;
+                const size_t oldToomCutoff = ToomMultiplyCutoff;
+                const size_t oldNttCutoff = NttMultiplyCutoff;
+                KaratsubaMultiplyCutoff = SIZE_MAX;
+                ToomMultiplyCutoff = SIZE_MAX;
+                NttMultiplyCutoff = nttCutoff;
+
+                const auto start = std::chrono::steady_clock::now();
+                product = a * b;
+                const auto stop = std::chrono::steady_clock::now();
+
+                KaratsubaMultiplyCutoff = oldKaratsubaCutoff;
+                ToomMultiplyCutoff = oldToomCutoff;
+                NttMultiplyCutoff = oldNttCutoff;
+                return std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+            };
+
+            size_t crossover = 0;
+            for( size_t numBytes = 256; numBytes <= 32768; numBytes *= 2 )
+            {
+                std::vector<uint8_t> aBytes( numBytes );
+                std::vector<uint8_t> bBytes( numBytes );
+                for( size_t iByte = 0; iByte < numBytes; ++iByte )
+                {
+                    aBytes[iByte] = static_cast<uint8_t>(iByte * 53 + 7);
+                    bBytes[iByte] = static_cast<uint8_t>(255 - iByte * 29);
+                }
+
+                const BigNum a( aBytes );
+                const BigNum b( bBytes );
+                BigNum baseline;
+                BigNum ntt;
+                const auto baselineTime = timeProduct( a, b, SIZE_MAX, baseline );
+                const auto nttTime = timeProduct( a, b, 1, ntt );
+                Assert::IsTrue( baseline.compare( ntt ) == Comparison::Equal );
+
+                if( crossover == 0 && nttTime < baselineTime )
+                    crossover = a.numberDigits();
+
+                const std::string message = std::to_string( a.numberDigits() ) + " digits: baseline " +
+                    std::to_string( baselineTime ) + " us, NTT " + std::to_string( nttTime ) + " us";
+                Logger::WriteMessage( message.c_str() );
+            }
+
+            const std::string message = "NTT overtakes the baseline multiplier at " +
+                std::to_string( crossover ) + " digits";
+            Logger::WriteMessage( message.c_str() );
+        }
+
+        TEST_METHOD( TestDigitKernels )
+        {
+            // Whatever kernels were selected for this machine must agree with the portable ones.
+            // Runs of b - 1 digits make carries and borrows ripple across whole vector blocks.
+            const DigitKernels & kernels = digitKernels();
+            const DigitKernels & scalar = scalarDigitKernels();
+            uint32_t seed = 12345;
+            auto nextDigit = [&seed]() -> BigNum::digit_t
+            {
+                seed = seed * 1103515245 + 12345;
+                return (seed >> 8) % 3 == 0 ? DigitMask : (seed & DigitMask);
+            };
+
+            for( size_t count = 0; count < 40; ++count )
+            {
+                std::vector<BigNum::digit_t> x( count );
+                std::vector<BigNum::digit_t> y( count );
+                for( size_t iDigit = 0; iDigit < count; ++iDigit )
+                {
+                    x[iDigit] = nextDigit();
+                    y[iDigit] = nextDigit();
+                }
+
+                std::vector<BigNum::digit_t> expected( x );
+                std::vector<BigNum::digit_t> actual( x );
+                Assert::AreEqual( scalar.addDigits( expected.data(), y.data(), count ),
+                    kernels.addDigits( actual.data(), y.data(), count ) );
+                Assert::IsTrue( expected == actual );
+
+                Assert::AreEqual( scalar.subtractDigits( expected.data(), y.data(), count ),
+                    kernels.subtractDigits( actual.data(), y.data(), count ) );
+                Assert::IsTrue( expected == actual );
+
+                const BigNum::digit_t multiplier = nextDigit();
+                Assert::AreEqual( scalar.multiplyAddDigits( expected.data(), y.data(), count, multiplier ),
+                    kernels.multiplyAddDigits( actual.data(), y.data(), count, multiplier ) );
+                Assert::IsTrue( expected == actual );
+
+                const size_t numBits = 1 + count % (DigitBits - 2);
+                Assert::AreEqual( scalar.shiftLeftDigits( expected.data(), count, numBits ),
+                    kernels.shiftLeftDigits( actual.data(), count, numBits ) );
+                Assert::IsTrue( expected == actual );
+
+                scalar.shiftRightDigits( expected.data(), count, numBits + 1 );
+                kernels.shiftRightDigits( actual.data(), count, numBits + 1 );
+                Assert::IsTrue( expected == actual );
+            }
+        }
+
+        TEST_METHOD( TestDigitArena )
+        {
+            const BigNum large( std::vector<uint8_t>( 1024, 0xA5 ) );
+            const BigNum small( std::vector<uint8_t>{ 7 } );
+            DigitArena arena;
+
+            {
+                DigitArenaScope scope( arena );
+
+                // These need more digits than fit inline, so they are allocated from the arena.
+                BigNum product = large * small;
+                Assert::IsTrue( arena.bytesInUse() > 0 );
+
+                product += large;
+                Assert::IsTrue( large.compare( product / BigNum( std::vector<uint8_t>{ 8 } ) ) ==
+                    Comparison::Equal );
+            }
+
+            Assert::IsTrue( DigitArena::current() == nullptr );
+
+            arena.release();
+            Assert::AreEqual( static_cast<size_t>(0), arena.bytesInUse() );
+        }
+
+        TEST_METHOD( TestFusedMultiplyAdd )
+        {
+            const BigNum a( std::vector<uint8_t>{ 1, 2, 3, 4, 5, 6, 7, 8, 9 } );
+            const BigNum b( std::vector<uint8_t>{ 9, 8, 7, 6, 5, 4, 3, 2, 1 } );
+            const BigNum c( std::vector<uint8_t>{ 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } );
+
+            BigNum product( b );
+            product *= c;
+
+            BigNum expected( a );
+            expected += product;
+            BigNum actual = a + b * c;
+            Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+
+            // The product is larger than a, so this result is negative.
+            expected = a;
+            expected -= product;
+            actual = a - b * c;
+            Assert::IsTrue( actual.isNegative() );
+            Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+
+            // Accumulating a product of the destination with itself.
+            expected = a;
+            expected *= a;
+            expected += a;
+            actual = a;
+            actual += actual * actual;
+            Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+        }
+
         TEST_METHOD( TestMontgomeryInverse )
         {
+            // -31^-1 mod 2^DigitBits.
+#ifdef BIGNUM_64BIT_DIGITS
+            const BigNum::digit_t expected = 1190112520884487201;
+#else
             const BigNum::digit_t expected = 1108378657;
+#endif
             const BigNum a( std::vector<uint8_t>{ 31 } );
             const BigNum::digit_t actual = compute_montgomery_inverse( a );
             Assert::AreEqual( expected, actual );
         }
 
+        TEST_METHOD( TestGcd )
+        {
+            // 2^521 - 1 is prime, so multiplying two different factors by it leaves a gcd large
+            // enough for the Lehmer steps to kick in.
+            BigNum p;
+            p = 1;
+            p <<= 521;
+            p -= BigNum::fromDecimal( "1" );
+
+            const BigNum a( p * BigNum::fromDecimal( "-340282366920938463463374607431768211507" ) );
+            const BigNum b( p * BigNum::fromDecimal( "1000000000000000000000000000000000000000021" ) );
+            Assert::IsTrue( gcd( a, b ).compare( p ) == Comparison::Equal );
+
+            BigNum x;
+            BigNum y;
+            const BigNum g = extendedGcd( a, b, x, y );
+            Assert::IsTrue( g.compare( p ) == Comparison::Equal );
+            Assert::IsTrue( (a * x + b * y).compare( g ) == Comparison::Equal );
+
+            BigNum zero;
+            zero = 0;
+            Assert::IsTrue( gcd( a, zero ).compare( abs( a ) ) == Comparison::Equal );
+
+            // The inverse of a modulo p, checked by multiplying back.
+            const BigNum a2 = BigNum::fromHex( "-123456789abcdef0fedcba9876543210aaaaaaaabbbbbbbbccccccccdddddddd" );
+            const BigNum inverse = modInverse( a2, p );
+            Assert::IsFalse( inverse.isNegative() );
+            Assert::IsTrue( inverse.compare( p ) == Comparison::LessThan );
+
+            BigNum product( a2 * inverse );
+            product.mod( p );
+            Assert::IsTrue( product.compare( BigNum::fromDecimal( "1" ) ) == Comparison::Equal );
+
+            Assert::ExpectException<std::invalid_argument>( [&]() { modInverse( a, b ); } );
+        }
+
         TEST_METHOD( TestSingleDigitMultiply )
         {
             const BigNum expected( std::vector<uint8_t>{ 16 } );
@@ -174,6 +506,43 @@ namespace BigNumTests
             Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
         }
 
+        TEST_METHOD( TestSquare )
+        {
+            // Sizes on both sides of the Karatsuba cutoff.
+            for( size_t numberBytes : { 1, 40, 300, 1000 } )
+            {
+                std::vector<uint8_t> bytes( numberBytes );
+                for( size_t iByte = 0; iByte < bytes.size(); ++iByte )
+                    bytes[iByte] = static_cast<uint8_t>(0xff - iByte * 13);
+
+                BigNum x( bytes );
+                x.negate();
+
+                const BigNum expected( x * x );
+                const BigNum actual( square( x ) );
+                Assert::IsFalse( actual.isNegative() );
+                Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+            }
+        }
+
+        TEST_METHOD( TestMontgomerySquare )
+        {
+            std::vector<uint8_t> bytes( 128 );
+            for( size_t iByte = 0; iByte < bytes.size(); ++iByte )
+                bytes[iByte] = static_cast<uint8_t>(iByte * 7 + 3);
+
+            BigNum m( bytes );
+            m.multiplyByTwo();
+            m += BigNum( std::vector<uint8_t>{ 1 } );
+            BigNum x( bytes );
+            x.divideByTwo();
+
+            const BigNum::digit_t mInv = compute_montgomery_inverse( m );
+            const BigNum expected = montgomery_multiply( x, x, m, mInv );
+            const BigNum actual = montgomery_square( x, m, mInv );
+            Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+        }
+
         TEST_METHOD( TestMod )
         {
             const BigNum m( std::vector<uint8_t>{ 17 } );
@@ -183,11 +552,206 @@ namespace BigNumTests
             Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
         }
 
+        TEST_METHOD( TestTruncatedMultiply )
+        {
+            std::vector<uint8_t> xBytes( 150 );
+            std::vector<uint8_t> yBytes( 130 );
+            for( size_t iByte = 0; iByte < xBytes.size(); ++iByte )
+                xBytes[iByte] = static_cast<uint8_t>(iByte * 53 + 7);
+            for( size_t iByte = 0; iByte < yBytes.size(); ++iByte )
+                yBytes[iByte] = 0xff;
+
+            const BigNum x( xBytes );
+            const BigNum y( yBytes );
+            const BigNum product( x * y );
+
+            const BigNum low( multiplyLow( x, y, 20 ) );
+            Assert::IsTrue( low.compare( mod2b( product, 20 * DigitBits ) ) == Comparison::Equal );
+
+            // The high half can only fall short of the exact one, by less than 20 * b.
+            const BigNum high( multiplyHigh( x, y, 20 ) );
+            BigNum shortfall( rightDigitShift( product, 20 ) );
+            shortfall -= high;
+            Assert::IsFalse( shortfall.isNegative() );
+            Assert::IsTrue( shortfall.numberBits() <= DigitBits + 5 );
+        }
+
+        TEST_METHOD( TestBarrettReducer )
+        {
+            // An even modulus, which Montgomery reduction can't handle.
+            std::vector<uint8_t> mBytes( 128 );
+            for( size_t iByte = 0; iByte < mBytes.size(); ++iByte )
+                mBytes[iByte] = static_cast<uint8_t>(iByte * 53 + 7);
+            mBytes.back() &= 0xfe;
+
+            const BigNum m( mBytes );
+            const BarrettReducer reducer( m );
+
+            BigNum x( m );
+            x -= BigNum( std::vector<uint8_t>{ 1 } );
+            BigNum y( std::vector<uint8_t>( 100, 0xff ) );
+
+            for( size_t i = 0; i < 20; ++i )
+            {
+                BigNum expected( x * y );
+                expected.mod( m );
+
+                const BigNum actual( reducer.multiply( x, y ) );
+                Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+
+                y = x;
+                x = actual;
+            }
+
+            // Values outside of [0, b^2k) still reduce correctly.
+            BigNum large( x * y );
+            large *= y;
+            large.negate();
+            BigNum expected( large );
+            expected.mod( m );
+            reducer.reduce( large );
+            Assert::IsTrue( expected.compare( large ) == Comparison::Equal );
+        }
+
+        TEST_METHOD( TestMpnSpans )
+        {
+            typedef BigNum::digit_t digit_t;
+            const BigNum x = BigNum::fromHex( "fedcba9876543210fedcba9876543210fedcba9876543210fedcba98" );
+            const BigNum y = BigNum::fromHex( "923456789abcdef0123456789abcdef0123456789abcdef012345678" );
+            const size_t n = x.numberDigits();
+            Assert::AreEqual( n, y.numberDigits() );
+
+            // Three operand forms leave their sources alone.
+            BigNum sum;
+            digit_t carry = mpn::add_n( sum.writeDigits( n + 1 ), x.readDigits(), y.readDigits(), n );
+            sum.writeDigits( n + 1 )[n] = carry;
+            sum.finishDigits( n + 1 );
+            Assert::IsTrue( sum.compare( x + y ) == Comparison::Equal );
+
+            BigNum difference;
+            Assert::AreEqual( mpn::sub_n( difference.writeDigits( n ), x.readDigits(), y.readDigits(), n ),
+                digit_t( 0 ) );
+            difference.finishDigits( n );
+            Assert::IsTrue( difference.compare( x - y ) == Comparison::Equal );
+
+            BigNum product;
+            mpn::mul_basecase( product.writeDigits( 2 * n ), x.readDigits(), n, y.readDigits(), n );
+            product.finishDigits( 2 * n );
+            Assert::IsTrue( product.compare( x * y ) == Comparison::Equal );
+
+            BigNum xx;
+            mpn::sqr_basecase( xx.writeDigits( 2 * n ), x.readDigits(), n );
+            xx.finishDigits( 2 * n );
+            Assert::IsTrue( xx.compare( x * x ) == Comparison::Equal );
+
+            // addmul_1 and submul_1 undo each other.
+            BigNum accumulator( product );
+            digit_t * digits = accumulator.writeDigits( 2 * n );
+            const digit_t scalar = DigitMask - 12345;
+            carry = mpn::addmul_1( digits, x.readDigits(), n, scalar );
+            Assert::AreEqual( mpn::add_1( digits + n, digits + n, n, carry ), digit_t( 0 ) );
+            accumulator.finishDigits( 2 * n );
+            Assert::IsTrue( accumulator.compare( product + x * scalar ) == Comparison::Equal );
+
+            const digit_t borrow = mpn::submul_1( digits, x.readDigits(), n, scalar );
+            Assert::AreEqual( mpn::sub_1( digits + n, digits + n, n, borrow ), digit_t( 0 ) );
+            accumulator.finishDigits( 2 * n );
+            Assert::IsTrue( accumulator.compare( product ) == Comparison::Equal );
+
+            // Out of place shifts, where the shifted digits end up one digit above or below.
+            BigNum shifted;
+            digits = shifted.writeDigits( n + 1 );
+            digits[n] = mpn::lshift( digits, x.readDigits(), n, 5 );
+            shifted.finishDigits( n + 1 );
+            Assert::IsTrue( shifted.compare( x << 5 ) == Comparison::Equal );
+
+            Assert::AreEqual( mpn::rshift( digits, digits, n + 1, 5 ), digit_t( 0 ) );
+            shifted.finishDigits( n );
+            Assert::IsTrue( shifted.compare( x ) == Comparison::Equal );
+
+            // Montgomery reduction of x * y by an odd modulus m gives x * y * b^-n mod m.
+            BigNum m( x );
+            m += y;
+            if( m.isEven() )
+            {
+                BigNum one;
+                one = 1;
+                m += one;
+            }
+
+            const size_t mDigits = m.numberDigits();
+            BigNum t( x * y );
+            t.mod( m );
+            t.leftDigitShift( mDigits );
+            digits = t.writeDigits( 2 * mDigits + 1 );
+            std::fill( digits + t.numberDigits(), digits + 2 * mDigits + 1, 0 );
+            mpn::redc_1( digits, digits, m.readDigits(), mDigits, compute_montgomery_inverse( m ) );
+            t.finishDigits( mDigits );
+
+            BigNum expected( x * y );
+            expected.mod( m );
+            Assert::IsTrue( t.compare( expected ) == Comparison::Equal );
+
+            // The single pass kernel gives the same result as multiplying and reducing separately.
+            BigNum separate( x * y );
+            separate.montgomeryReduce( m, compute_montgomery_inverse( m ) );
+
+            BigNum integrated;
+            digits = integrated.writeDigits( mDigits + 1 );
+            mpn::mulredc_1( digits, x.readDigits(), n, y.readDigits(), n, m.readDigits(), mDigits,
+                compute_montgomery_inverse( m ), digits );
+            integrated.finishDigits( mDigits );
+            Assert::IsTrue( integrated.compare( separate ) == Comparison::Equal );
+        }
+
+        TEST_METHOD( TestBigNumAccumulator )
+        {
+            // A dot product with terms of both signs and of very different sizes, including one
+            // large enough for Karatsuba, checked against the same sum computed with operator+=.
+            BigNumAccumulator accumulator;
+            BigNum expected;
+            expected = 0;
+
+            BigNum x = BigNum::fromHex( "f0e1d2c3b4a5968778695a4b3c2d1e0f" );
+            BigNum y = BigNum::fromHex( "-123456789abcdef" );
+            for( size_t iTerm = 0; iTerm < 100; ++iTerm )
+            {
+                accumulator.addProduct( x, y );
+                expected += x * y;
+
+                accumulator.subtractProduct( y, y );
+                expected -= y * y;
+
+                accumulator.addProduct( x, DigitMask );
+                expected += x * DigitMask;
+
+                accumulator.add( y );
+                expected += y;
+
+                x.multiplyByTwo();
+                x += y;
+                y.negate();
+                y *= 3;
+            }
+
+            BigNum large;
+            large = 1;
+            large.leftDigitShift( KaratsubaMultiplyCutoff + 5 );
+            large -= x;
+            accumulator.subtractProduct( large, large );
+            expected -= large * large;
+
+            Assert::IsTrue( accumulator.value().compare( expected ) == Comparison::Equal );
+
+            accumulator.zero();
+            Assert::IsTrue( accumulator.value().isZero() );
+        }
+
         TEST_METHOD( TestNumberBits )
         {
             BigNum x( std::vector<uint8_t>{ 1 } );
             x.leftDigitShift( 1 );
-            const size_t expected = 32;
+            const size_t expected = DigitBits + 1;
             Assert::AreEqual( expected, x.numberBits() );
         }
 
@@ -200,6 +764,78 @@ namespace BigNumTests
             Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
         }
 
+        TEST_METHOD( TestMultiDigitDivide )
+        {
+            // x = 2^1024 - 1 and y = 2^64 - 1, so y divides x evenly.
+            const BigNum x( std::vector<uint8_t>( 128, 0xFF ) );
+            const BigNum y( std::vector<uint8_t>( 8, 0xFF ) );
+            const BigNum q = x / y;
+            Assert::IsTrue( x.compare( q * y ) == Comparison::Equal );
+
+            BigNum r( x );
+            r.mod( y );
+            Assert::IsTrue( r.isZero() );
+        }
+
+        TEST_METHOD( TestBurnikelZieglerDivide )
+        {
+            std::vector<uint8_t> xBytes( 3000 );
+            std::vector<uint8_t> yBytes( 1100 );
+            for( size_t iByte = 0; iByte < xBytes.size(); ++iByte )
+                xBytes[iByte] = iByte < 700 ? 0xff : static_cast<uint8_t>(iByte * 53 + 7);
+            for( size_t iByte = 0; iByte < yBytes.size(); ++iByte )
+                yBytes[iByte] = iByte < 300 ? 0xff : static_cast<uint8_t>(255 - iByte * 29);
+
+            const BigNum x( xBytes );
+            BigNum y( yBytes );
+            y.negate();
+
+            const size_t oldCutoff = BurnikelZieglerDivideCutoff;
+            BurnikelZieglerDivideCutoff = SIZE_MAX;
+            const BigNum expectedQ( x / y );
+            BigNum expectedR( x );
+            expectedR.mod( abs( y ) );
+
+            BurnikelZieglerDivideCutoff = 4;
+            const BigNum q( x / y );
+            BigNum r( x );
+            r.mod( abs( y ) );
+            BurnikelZieglerDivideCutoff = oldCutoff;
+
+            Assert::IsTrue( q.isNegative() );
+            Assert::IsTrue( expectedQ.compare( q ) == Comparison::Equal );
+            Assert::IsTrue( expectedR.compare( r ) == Comparison::Equal );
+
+            // x = q * y + r
+            BigNum check( r );
+            check += q * y;
+            Assert::IsTrue( check.compare( x ) == Comparison::Equal );
+        }
+
+        TEST_METHOD( TestInlineAndHeapDigits )
+        {
+            // 8192 bits is more than a BigNum holds inline, so these digits end up on the heap.
+            const BigNum large( std::vector<uint8_t>( 1024, 0xA5 ) );
+            const BigNum small( std::vector<uint8_t>{ 7 } );
+
+            BigNum copy( large );
+            Assert::IsTrue( large.compare( copy ) == Comparison::Equal );
+
+            copy += large;
+            copy -= large;
+            Assert::IsTrue( large.compare( copy ) == Comparison::Equal );
+
+            BigNum assigned( small );
+            assigned = large;
+            Assert::IsTrue( large.compare( assigned ) == Comparison::Equal );
+
+            assigned = small;
+            Assert::IsTrue( small.compare( assigned ) == Comparison::Equal );
+
+            const BigNum product = large * small;
+            Assert::IsTrue( large.compare( product / small ) == Comparison::Equal );
+        }
+
         TEST_METHOD( TestBiterator )
         {
             const BigNum x( std::vector<uint8_t>{ 36 } );
@@ -213,6 +849,62 @@ namespace BigNumTests
             Assert::IsFalse( bi.hasBits() );
         }
 
+        TEST_METHOD( TestBiteratorWindows )
+        {
+            const BigNum x = BigNum::fromHex( "F3A5000000000000000000000000C96B0123456789ABCDEF1" );
+
+            // Reading k bits at a time in either order must reassemble the original number, including
+            // windows that straddle two digits and a short final window.
+            for( size_t k : { size_t( 1 ), size_t( 5 ), size_t( DigitBits ) } )
+            {
+                BigNum fromTop;
+                fromTop = 0;
+                auto msb = x.createBiterator();
+                while( msb.hasBits() )
+                {
+                    const size_t numBits = std::min( k, msb.bitsLeft() );
+                    fromTop <<= numBits;
+                    BigNum window;
+                    window = msb.nextBits( k );
+                    fromTop += window;
+                }
+                Assert::IsTrue( fromTop.compare( x ) == Comparison::Equal );
+
+                BigNum fromBottom;
+                fromBottom = 0;
+                size_t shift = 0;
+                auto lsb = x.createBiterator( BigNum::biterator::Order::LeastSignificantFirst );
+                while( lsb.hasBits() )
+                {
+                    BigNum window;
+                    window = lsb.nextBits( k );
+                    fromBottom += window << shift;
+                    shift += k;
+                }
+                Assert::IsTrue( fromBottom.compare( x ) == Comparison::Equal );
+            }
+
+            // The zero run in the middle is 96 bits long.
+            auto msb = x.createBiterator();
+            Assert::AreEqual( msb.nextBits( 16 ), BigNum::digit_t( 0xF3A5 ) );
+            Assert::AreEqual( msb.skipZeros(), size_t( 96 ) );
+            Assert::AreEqual( msb.nextBits( 4 ), BigNum::digit_t( 0xC ) );
+            Assert::AreEqual( msb.skipZeros(), size_t( 0 ) );
+
+            const BigNum high = x >> 68;
+            auto lsb = high.createBiterator( BigNum::biterator::Order::LeastSignificantFirst );
+            Assert::AreEqual( lsb.nextBits( 16 ), BigNum::digit_t( 0xC96B ) );
+            Assert::AreEqual( lsb.skipZeros(), size_t( 96 ) );
+            Assert::AreEqual( lsb.nextBits( 16 ), BigNum::digit_t( 0xF3A5 ) );
+            Assert::IsFalse( lsb.hasBits() );
+
+            BigNum zero;
+            zero = 0;
+            auto empty = zero.createBiterator();
+            Assert::IsFalse( empty.hasBits() );
+            Assert::AreEqual( empty.skipZeros(), size_t( 0 ) );
+        }
+
         TEST_METHOD( TestModularExponentiation )
         {
             constexpr bool swizzle = true;
@@ -242,6 +934,50 @@ namespace BigNumTests
             Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
         }
 
+        TEST_METHOD( TestSlidingWindowExponentiation )
+        {
+            Assert::AreEqual( size_t( 1 ), slidingWindowBits( 6 ) );
+            Assert::AreEqual( size_t( 2 ), slidingWindowBits( 7 ) );
+            Assert::AreEqual( size_t( 4 ), slidingWindowBits( 240 ) );
+            Assert::AreEqual( size_t( 5 ), slidingWindowBits( 241 ) );
+            Assert::AreEqual( size_t( 7 ), slidingWindowBits( 2048 ) );
+            Assert::AreEqual( MaxWindowBits, slidingWindowBits( 100000 ) );
+
+            // Drive the windows with ordinary modular arithmetic and compare with binary
+            // exponentiation, for every window width. The exponent has long runs of zeros and ones.
+            const BigNum n( BigNum::fromHex( "f123456789abcdef0123456789abcdef0123456789abcdef01234567" ) );
+            const BigNum x( BigNum::fromHex( "3141592653589793238462643383279502884197169399375105" ) );
+            const BigNum e( BigNum::fromHex( "80000000ffffffff000000000000000123456789a5a5a5a500" ) );
+
+            BigNum expected;
+            expected = 1;
+            auto iExponentBits = e.createBiterator();
+            while( iExponentBits.hasBits() )
+            {
+                expected = (expected * expected).mod( n );
+                if( iExponentBits.nextBit() != 0 )
+                    expected = (expected * x).mod( n );
+            }
+
+            for( size_t windowBits = 1; windowBits <= MaxWindowBits; ++windowBits )
+            {
+                std::vector<BigNum> powers( size_t( 1 ) << (windowBits - 1) );
+                powers[0] = x;
+                const BigNum x2 = (x * x).mod( n );
+                for( size_t iPower = 1; iPower < powers.size(); ++iPower )
+                    powers[iPower] = (powers[iPower - 1] * x2).mod( n );
+
+                BigNum a;
+                a = 1;
+                slidingWindowExponentiation( e, windowBits,
+                    [&]() { a = (a * a).mod( n ); },
+                    [&]( size_t iPower ) { a = (a * powers[iPower]).mod( n ); },
+                    [&]( size_t iPower ) { a = powers[iPower]; } );
+
+                Assert::IsTrue( a.compare( expected ) == Comparison::Equal );
+            }
+        }
+
         TEST_METHOD( TestRsa )
         {
             constexpr bool swizzle = true;
@@ -319,6 +1055,29 @@ namespace BigNumTests
             Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
         }
 
+        TEST_METHOD( TestLoadStoreBlocks )
+        {
+            constexpr bool swizzle = true;
+            constexpr size_t blockSize = 64;
+            std::vector<uint8_t> inputBytes( 5 * blockSize );
+            for( size_t iByte = 0; iByte < inputBytes.size(); ++iByte )
+                inputBytes[iByte] = static_cast<uint8_t>(iByte * 53 + 7);
+
+            const std::vector<BigNum> blocks = BigNum::loadBlocks( inputBytes.data(),
+                inputBytes.size(), blockSize, swizzle, sizeof( uint32_t ) );
+            Assert::AreEqual( size_t( 5 ), blocks.size() );
+
+            // Each block matches a block loaded on its own.
+            BigNum expected;
+            expected.loadBytes( inputBytes.data() + 2 * blockSize, blockSize, true, swizzle,
+                sizeof( uint32_t ) );
+            Assert::IsTrue( expected.compare( blocks[2] ) == Comparison::Equal );
+
+            std::vector<uint8_t> outputBytes( inputBytes.size() );
+            BigNum::storeBlocks( blocks, outputBytes.data(), blockSize, swizzle, sizeof( uint32_t ) );
+            Assert::IsTrue( inputBytes == outputBytes );
+        }
+
         TEST_METHOD( TestRoundTripSwizzle )
         {
             constexpr bool swizzle = true;
@@ -357,6 +1116,55 @@ namespace BigNumTests
             Assert::AreEqual( 2u, c.numberBytes() );
         }
 
+        TEST_METHOD( TestHexConversion )
+        {
+            const BigNum x( std::vector<uint8_t>{ 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0x0f } );
+            Assert::AreEqual( std::string( "123456789abcdef0f" ), x.toHex() );
+            Assert::IsTrue( BigNum::fromHex( "0x123456789ABCDEF0F" ).compare( x ) == Comparison::Equal );
+
+            const BigNum y( BigNum::fromHex( "-000ff" ) );
+            Assert::IsTrue( y.isNegative() );
+            Assert::AreEqual( std::string( "-ff" ), y.toHex() );
+            Assert::AreEqual( std::string( "0" ), BigNum::fromHex( "-0" ).toHex() );
+
+            const std::string digits( 1001, 'f' );
+            Assert::AreEqual( digits, BigNum::fromHex( digits ).toHex() );
+        }
+
+        TEST_METHOD( TestDecimalConversion )
+        {
+            // 2^100
+            BigNum x;
+            x = 1;
+            x <<= 100;
+            Assert::AreEqual( std::string( "1267650600228229401496703205376" ), x.toDecimal() );
+            Assert::IsTrue( BigNum::fromDecimal( "1267650600228229401496703205376" ).compare( x ) ==
+                Comparison::Equal );
+            Assert::AreEqual( std::string( "-42" ), BigNum::fromDecimal( "-0042" ).toDecimal() );
+            Assert::AreEqual( std::string( "0" ), BigNum::fromDecimal( "0" ).toDecimal() );
+
+            // Large enough to split many times, with runs of zeros across the splits.
+            BigNum power;
+            power = 1;
+            BigNum ten;
+            ten = 10;
+            for( size_t i = 0; i < 3000; ++i )
+                power *= ten;
+
+            const std::string powerDecimal = "1" + std::string( 3000, '0' );
+            Assert::AreEqual( powerDecimal, power.toDecimal() );
+            Assert::IsTrue( BigNum::fromDecimal( powerDecimal ).compare( power ) == Comparison::Equal );
+
+            power -= BigNum( std::vector<uint8_t>{ 1 } );
+            Assert::AreEqual( std::string( 3000, '9' ), power.toDecimal() );
+
+            std::string digits( 5000, '0' );
+            for( size_t i = 0; i < digits.size(); ++i )
+                digits[i] = static_cast<char>('1' + (i * 7) % 9);
+
+            Assert::AreEqual( digits, BigNum::fromDecimal( digits ).toDecimal() );
+        }
+
         TEST_METHOD( TestRoundTripRsaEncrypt )
         {
             constexpr bool swizzle = true;
@@ -461,5 +1269,356 @@ namespace BigNumTests
             Assert::AreEqual( std::string( plaintext, sizeof( plaintext ) ),
                 std::string( reinterpret_cast<char *>(decrypted.data()), outputBytesWritten ) );
         }
+
+        TEST_METHOD( TestMontgomeryContext )
+        {
+            const BigNum base( BigNum::fromHex( "3b9aca07deadbeef0123456789abcdef" ) );
+            const BigNum e( BigNum::fromHex( "d1ce5eed0ddba11cafef00d15ea5e1234567" ) );
+            BigNum one;
+            one = 1;
+
+            // A small modulus and one of RSA size, whose products the reference arithmetic below
+            // forms with Karatsuba multiplication.
+            const size_t sizes[] = { 16, KaratsubaMultiplyCutoff + 3 };
+            for( const size_t numDigits : sizes )
+            {
+                std::string hex( numDigits * DigitBits / 4, '9' );
+                hex.back() = 'b';
+                const BigNum modulus( BigNum::fromHex( "c" + hex ) );
+
+                BigNum r( std::vector<uint8_t>{ 1 } );
+                r.leftDigitShift( modulus.numberDigits() ).mod( modulus );
+
+                const BigNum r2 = (r * r).mod( modulus );
+                const BigNum::digit_t nInv = compute_montgomery_inverse( modulus );
+
+                const MontgomeryContext context( modulus );
+                Assert::AreEqual( nInv, context.nInv() );
+                Assert::IsTrue( context.r().compare( r ) == Comparison::Equal );
+                Assert::IsTrue( context.r2().compare( r2 ) == Comparison::Equal );
+
+                const BigNum x( (base * base * base).mod( modulus ) );
+                const BigNum y( (x * base).mod( modulus ) );
+                const BigNum product( montgomery_multiply( x, y, modulus, nInv ) );
+                const BigNum square( montgomery_multiply( x, x, modulus, nInv ) );
+                const BigNum roundTrip( context.fromMontgomery( context.toMontgomery( x ) ) );
+                Assert::IsTrue( context.multiply( x, y ).compare( product ) == Comparison::Equal );
+                Assert::IsTrue( context.square( x ).compare( square ) == Comparison::Equal );
+                Assert::IsTrue( roundTrip.compare( x ) == Comparison::Equal );
+
+                const BigNum expected( montgomery_exponentiation( x, e, modulus, nInv, r, r2 ) );
+                Assert::IsTrue( context.exp( x, e ).compare( expected ) == Comparison::Equal );
+                Assert::IsTrue( context.exp( x, BigNum() ).compare( one ) == Comparison::Equal );
+
+                // A context is shared between threads, each of which uses its own scratch space.
+                bool matches[4];
+                std::vector<std::thread> threads;
+                for( bool & match : matches )
+                {
+                    threads.emplace_back( [&context, &x, &e, &expected, &match]()
+                        {
+                            match = context.exp( x, e ).compare( expected ) == Comparison::Equal;
+                        } );
+                }
+
+                for( std::thread & thread : threads )
+                    thread.join();
+
+                for( const bool match : matches )
+                    Assert::IsTrue( match );
+            }
+
+            Assert::ExpectException<std::invalid_argument>(
+                []() { MontgomeryContext context( BigNum::fromHex( "1000" ) ); } );
+            Assert::ExpectException<std::invalid_argument>(
+                []() { MontgomeryContext context( BigNum::fromHex( "1" ) ); } );
+        }
+
+        TEST_METHOD( TestShortExponentiation )
+        {
+            const std::string sevens( 2 * KaratsubaMultiplyCutoff * DigitBits / 8, '7' );
+            const BigNum moduli[] = {
+                BigNum::fromHex( "f123456789abcdef0123456789abcdef0123456789abcdef01234567" ),
+                BigNum::fromHex( "c" + sevens )
+            };
+            const BigNum::digit_t exponents[] = { 0, 1, 2, 3, 17, 65537, 0x5a5a5a5a, DigitMask };
+
+            for( const BigNum & modulus : moduli )
+            {
+                BigNum r( std::vector<uint8_t>{ 1 } );
+                r.leftDigitShift( modulus.numberDigits() ).mod( modulus );
+
+                const BigNum r2 = (r * r).mod( modulus );
+                const BigNum::digit_t nInv = compute_montgomery_inverse( modulus );
+                const MontgomeryContext context( modulus );
+                const BigNum x(
+                    BigNum::fromHex( "3141592653589793238462643383279502884197169399375105" ) );
+
+                for( const BigNum::digit_t exponent : exponents )
+                {
+                    BigNum e;
+                    e = exponent;
+
+                    // Plain binary exponentiation with ordinary modular arithmetic.
+                    BigNum expected;
+                    expected = 1;
+                    auto iExponentBits = e.createBiterator();
+                    while( iExponentBits.hasBits() )
+                    {
+                        expected = (expected * expected).mod( modulus );
+                        if( iExponentBits.nextBit() != 0 )
+                            expected = (expected * x).mod( modulus );
+                    }
+
+                    const BigNum actual( montgomery_exponentiation( x, e, modulus, nInv, r, r2 ) );
+                    Assert::IsTrue( actual.compare( expected ) == Comparison::Equal );
+                    Assert::IsTrue( context.exp( x, e ).compare( expected ) == Comparison::Equal );
+                    Assert::IsTrue(
+                        context.expShort( x, exponent ).compare( expected ) == Comparison::Equal );
+                }
+
+                BigNum f4;
+                f4 = 65537;
+                const BigNum power( context.expConstantTime( x, f4 ) );
+                const BigNum cube( (x * x * x).mod( modulus ) );
+                Assert::IsTrue( context.expFermat<16>( x ).compare( power ) == Comparison::Equal );
+                Assert::IsTrue( context.expFermat<1>( x ).compare( cube ) == Comparison::Equal );
+            }
+        }
+
+        TEST_METHOD( TestConstantTimeExponentiation )
+        {
+            typedef BigNum::digit_t digit_t;
+
+            // Masked operations and table lookups.
+            const digit_t a[] = { DigitMask, 5, 7 };
+            const digit_t b[] = { 1, 2, 3 };
+            digit_t dst[3];
+            Assert::AreEqual( mpn::cnd_add_n( 0, dst, a, b, 3 ), digit_t( 0 ) );
+            Assert::IsTrue( mpn::cmp( dst, a, 3 ) == Comparison::Equal );
+            Assert::AreEqual( mpn::cnd_add_n( 1, dst, a, b, 3 ), digit_t( 0 ) );
+            Assert::AreEqual( mpn::cnd_sub_n( 2, dst, dst, b, 3 ), digit_t( 0 ) );
+            Assert::IsTrue( mpn::cmp( dst, a, 3 ) == Comparison::Equal );
+            Assert::AreEqual( mpn::cnd_sub_n( 1, dst, b, a, 3 ), digit_t( 1 ) );
+
+            const digit_t table[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+            mpn::sec_tabselect( dst, table, 3, 3, 1 );
+            Assert::IsTrue( mpn::cmp( dst, table + 3, 3 ) == Comparison::Equal );
+
+            // Exponentiation matches the variable time version for small and large moduli, and for
+            // exponents that are zero, short or longer than the modulus.
+            const std::string sevens( 2 * KaratsubaMultiplyCutoff * DigitBits / 8, '7' );
+            const BigNum moduli[] = {
+                BigNum::fromHex( "f123456789abcdef0123456789abcdef0123456789abcdef01234567" ),
+                BigNum::fromHex( "c" + sevens )
+            };
+            const BigNum exponents[] = {
+                BigNum(),
+                BigNum::fromHex( "10001" ),
+                BigNum::fromHex( "80000000ffffffff000000000000000123456789a5a5a5a500" ),
+                BigNum::fromHex( std::string( 2 * KaratsubaMultiplyCutoff * DigitBits / 4, 'b' ) )
+            };
+
+            for( const BigNum & modulus : moduli )
+            {
+                BigNum r( std::vector<uint8_t>{ 1 } );
+                r.leftDigitShift( modulus.numberDigits() ).mod( modulus );
+
+                const BigNum r2 = (r * r).mod( modulus );
+                const BigNum::digit_t nInv = compute_montgomery_inverse( modulus );
+                const MontgomeryContext context( modulus );
+                const BigNum x(
+                    BigNum::fromHex( "3141592653589793238462643383279502884197169399375105" ) );
+
+                for( const BigNum & e : exponents )
+                {
+                    const BigNum expected(
+                        montgomery_exponentiation( x, e, modulus, nInv, r, r2 ) );
+                    const BigNum actual(
+                        constant_time_montgomery_exponentiation( x, e, modulus, nInv, r, r2 ) );
+                    Assert::IsTrue( actual.compare( expected ) == Comparison::Equal );
+                    Assert::IsTrue(
+                        context.expConstantTime( x, e ).compare( expected ) == Comparison::Equal );
+                }
+            }
+        }
+
+        TEST_METHOD( TestRoundTripRsaEncryptMontgomeryContext )
+        {
+            const char plaintext[] = "A context is built once per key and shared by every block.";
+
+            const uint8_t modulusValue[] = {
+                0xb8, 0x95, 0x76, 0x2c, 0x77, 0xc2, 0xdb, 0x98, 0x78, 0x46, 0x18, 0x18, 0xed, 0x75, 0x55, 0xfa,
+                0xa6, 0xbe, 0x1d, 0xca, 0x8a, 0xe7, 0x5a, 0xb9, 0xf2, 0x13, 0x13, 0xdf, 0x38, 0x69, 0xb7, 0x95
+            };
+            const uint8_t publicExpValue[] = { 0x01, 0x00, 0x01 };
+            const uint8_t privateExpValue[] = {
+                0x6d, 0x1f, 0x2e, 0xf5, 0xaa, 0xf7, 0x6f, 0x8a, 0xfb, 0xcf, 0xb4, 0x7f, 0x48, 0x22, 0x8d, 0xe8,
+                0xd4, 0x41, 0xce, 0xd1, 0x6d, 0x68, 0x60, 0x19, 0x02, 0x02, 0x5d, 0x69, 0x31, 0xb3, 0x32, 0x01
+            };
+
+            const MontgomeryContext context( BigNum( modulusValue, sizeof( modulusValue ) ) );
+            const BigNum publicExp( publicExpValue, sizeof( publicExpValue ) );
+            const BigNum privateExp( privateExpValue, sizeof( privateExpValue ) );
+
+            const size_t bytesPerInputBlock = (context.modulus().numberBits() - 1) / 8;
+            const size_t numInputBlocks =
+                (sizeof( plaintext ) + bytesPerInputBlock - 1) / bytesPerInputBlock;
+
+            std::vector<uint8_t> cipher( numInputBlocks * context.modulus().numberBytes() );
+            rsaEncrypt( reinterpret_cast<const uint8_t *>(plaintext), sizeof( plaintext ),
+                cipher.data(), cipher.size(), context, publicExp );
+
+            std::vector<uint8_t> decrypted( cipher.size() );
+            size_t outputBytesWritten;
+            rsaDecrypt( cipher.data(), cipher.size(),
+                decrypted.data(), decrypted.size(), outputBytesWritten, context, privateExp );
+
+            Assert::AreEqual( sizeof( plaintext ), outputBytesWritten );
+            Assert::AreEqual( std::string( plaintext, sizeof( plaintext ) ),
+                std::string( reinterpret_cast<char *>(decrypted.data()), outputBytesWritten ) );
+        }
+
+        TEST_METHOD( TestRsaDecryptCrt )
+        {
+            const BigNum p( BigNum::fromHex(
+                "f5959aaf57de62929baef7b68083c221893a8ee2a33f213314b5bdd4b6c91a1e"
+                "c499254eb191ff890dcfccfe611938ce37682883c12d89312d39c3f04ec15a55" ) );
+            const BigNum q( BigNum::fromHex(
+                "f2e9d8697b585de31bd951e2a74f0cfcb3ef6e07373149e8164804b879f91e46"
+                "f813ab6c26651d6a6ca33b4f8496ce28ed3229bbeebb9ea9a9a9a6231064d31d" ) );
+            const BigNum d( BigNum::fromHex(
+                "81d7fd34d37f3ee69c21c7525c1e7360b1d6562ecc8343ccdd807cf95933d62d"
+                "ef0ce04d43f5c5774320926dc1deedb14bc0c71c963c7ec2036cb30fe130f681"
+                "509ace1324ac8cc18da6ad7302aeedb092070905e706398a6f6da22b73a43ba4"
+                "4be7687d5718a57798345200277bd737102818deb36ffc37aa8b9dbb90ff6ff1" ) );
+            const BigNum publicExp( BigNum::fromHex( "10001" ) );
+
+            // The key works with the primes in either order, and from its PKCS #1 components.
+            const RsaPrivateKey key( p, q, d );
+            const RsaPrivateKey swapped( q, p, d );
+            const RsaPrivateKey components( p, q, key.dp(), key.dq(), key.qInv() );
+            const BigNum one( std::vector<uint8_t>{ 1 } );
+            Assert::IsTrue( (key.qInv() * q).mod( p ).compare( one ) == Comparison::Equal );
+
+            const BigNum n( key.modulus() );
+            BigNum r( std::vector<uint8_t>{ 1 } );
+            r.leftDigitShift( n.numberDigits() ).mod( n );
+
+            const BigNum r2 = (r * r).mod( n );
+            const BigNum::digit_t nInv = compute_montgomery_inverse( n );
+
+            const BigNum messages[] = {
+                BigNum(),
+                BigNum::fromHex( "2a" ),
+                p,
+                n - one,
+                BigNum::fromHex(
+                    "3141592653589793238462643383279502884197169399375105820974944592" )
+            };
+            for( const BigNum & c : messages )
+            {
+                const BigNum expected( montgomery_exponentiation( c, d, n, nInv, r, r2 ) );
+                Assert::IsTrue( key.decrypt( c ).compare( expected ) == Comparison::Equal );
+                Assert::IsTrue( swapped.decrypt( c ).compare( expected ) == Comparison::Equal );
+                Assert::IsTrue( components.decrypt( c ).compare( expected ) == Comparison::Equal );
+            }
+
+            const char plaintext[] = "Private-key operations use the CRT form of the key.";
+            const size_t bytesPerInputBlock = (n.numberBits() - 1) / 8;
+            const size_t numInputBlocks =
+                (sizeof( plaintext ) + bytesPerInputBlock - 1) / bytesPerInputBlock;
+
+            std::vector<uint8_t> cipher( numInputBlocks * n.numberBytes() );
+            rsaEncrypt( reinterpret_cast<const uint8_t *>(plaintext), sizeof( plaintext ),
+                cipher.data(), cipher.size(), n, publicExp, nInv, r, r2 );
+
+            std::vector<uint8_t> decrypted( cipher.size() );
+            size_t outputBytesWritten;
+            rsaDecryptCrt( cipher.data(), cipher.size(),
+                decrypted.data(), decrypted.size(), outputBytesWritten, key );
+
+            Assert::AreEqual( sizeof( plaintext ), outputBytesWritten );
+            Assert::AreEqual( std::string( plaintext, sizeof( plaintext ) ),
+                std::string( reinterpret_cast<char *>(decrypted.data()), outputBytesWritten ) );
+
+            // Primes of different lengths, 2^61 - 1 and 2^127 - 1, so that c and m2 are reduced in
+            // several chunks of the smaller prime.
+            const BigNum shortPrime( BigNum::fromHex( "1fffffffffffffff" ) );
+            const BigNum longPrime( BigNum::fromHex( "7fffffffffffffffffffffffffffffff" ) );
+            const RsaPrivateKey unbalanced( shortPrime, longPrime, d );
+            const RsaPrivateKey unbalancedSwapped( longPrime, shortPrime, d );
+
+            const BigNum n2( unbalanced.modulus() );
+            BigNum r3( std::vector<uint8_t>{ 1 } );
+            r3.leftDigitShift( n2.numberDigits() ).mod( n2 );
+
+            const BigNum r4 = (r3 * r3).mod( n2 );
+            const BigNum::digit_t n2Inv = compute_montgomery_inverse( n2 );
+
+            const BigNum unbalancedMessages[] = {
+                BigNum::fromHex( "2a" ),
+                longPrime + BigNum::fromHex( "5" ),
+                n2 - one,
+                BigNum::fromHex( "31415926535897932384626433832795028841971693" )
+            };
+            for( const BigNum & c : unbalancedMessages )
+            {
+                const BigNum expected( montgomery_exponentiation( c, d, n2, n2Inv, r3, r4 ) );
+                Assert::IsTrue( unbalanced.decrypt( c ).compare( expected ) == Comparison::Equal );
+                Assert::IsTrue(
+                    unbalancedSwapped.decrypt( c ).compare( expected ) == Comparison::Equal );
+            }
+
+            Assert::ExpectException<std::invalid_argument>(
+                [&]() { RsaPrivateKey bad( p, p, d ); } );
+        }
+
+        TEST_METHOD( TestFixedBigNumAddSubtract )
+        {
+            const BigNum a( std::vector<uint8_t>( 8, 0xFF ) );
+            const BigNum b( std::vector<uint8_t>{ 1 } );
+
+            FixedBigNum<96> x( a );
+            const FixedBigNum<96> y( b );
+            Assert::IsTrue( x.addEquals( y ) == 0 );
+            Assert::IsTrue( (a + b).compare( x.toBigNum() ) == Comparison::Equal );
+
+            Assert::IsTrue( x.subtractEquals( y ) == 0 );
+            Assert::IsTrue( a.compare( x.toBigNum() ) == Comparison::Equal );
+
+            const FixedBigNum<96> zero;
+            Assert::IsTrue( zero.compare( FixedBigNum<96>() ) == Comparison::Equal );
+            Assert::IsTrue( x.compare( zero ) == Comparison::GreaterThan );
+
+            // 2^64 - 1 squared still fits in the double length product.
+            const auto product = multiply( x, x );
+            Assert::IsTrue( BigNum( a * a ).compare( product.toBigNum() ) == Comparison::Equal );
+        }
+
+        TEST_METHOD( TestFixedBigNumExponentiation )
+        {
+            // Arbitrary odd 2048-bit modulus with its top bit set.
+            std::vector<uint8_t> modulusValue( 256 );
+            for( size_t iByte = 0; iByte < modulusValue.size(); ++iByte )
+                modulusValue[iByte] = static_cast<uint8_t>(iByte * 37 + 11);
+
+            modulusValue.front() |= 0x80;
+            modulusValue.back() |= 0x01;
+
+            const BigNum modulus( modulusValue );
+            const BigNum x( std::vector<uint8_t>( 200, 0x5A ) );
+            const BigNum e( std::vector<uint8_t>{ 0x01, 0x00, 0x01 } );
+
+            BigNum r( std::vector<uint8_t>{ 1 } );
+            r.leftDigitShift( modulus.numberDigits() ).mod( modulus );
+
+            const BigNum r2 = (r * r).mod( modulus );
+            const BigNum::digit_t nInv = compute_montgomery_inverse( modulus );
+
+            const BigNum expected = montgomery_exponentiation( x, e, modulus, nInv, r, r2 );
+            const BigNum actual = dispatch_montgomery_exponentiation( x, e, modulus, nInv, r, r2 );
+            Assert::IsTrue( expected.compare( actual ) == Comparison::Equal );
+        }
 	};
 }
@@ -0,0 +1,65 @@
+#include <stdexcept>
+
+#include "BarrettReducer.h"
+
+BarrettReducer::BarrettReducer( const BigNum & modulus ) :
+    m_modulus( modulus ),
+    m_numDigits( modulus.numberDigits() )
+{
+    if( modulus.isZero() || modulus.isNegative() )
+        throw std::invalid_argument( "Modulus must be positive." );
+
+    BigNum b2k;
+    b2k = 1;
+    b2k.leftDigitShift( 2 * m_numDigits );
+    m_mu = b2k / m_modulus;
+}
+
+BigNum & BarrettReducer::reduce( BigNum & x ) const
+{
+    const size_t k = m_numDigits;
+    if( x.isNegative() || x.numberDigits() > 2 * k )
+        return x.mod( m_modulus );
+
+    // q3 = floor(floor(x / b^(k-1)) * mu / b^(k+1)) is an estimate of floor(x / m) that is at most
+    // two too small. Only the columns of the product from k - 1 up are computed. The ones skipped
+    // add up to less than b^(k+1), so this can make q3 one smaller still.
+    BigNum q( x );
+    q.rightDigitShift( k - 1 );
+    q.multiplyHigh( m_mu, k - 1 );
+    q.rightDigitShift( 2 );
+
+    // r = (x - q3 * m) mod b^(k+1), where only the low k + 1 digits of q3 * m are needed.
+    q.multiplyLow( m_modulus, k + 1 );
+    x.mod2b( (k + 1) * DigitBits );
+    x -= q;
+
+    if( x.isNegative() )
+    {
+        BigNum bk1;
+        bk1 = 1;
+        bk1.leftDigitShift( k + 1 );
+        x += bk1;
+    }
+
+    // Two subtractions with an exact q3, and at most one more for the truncated product.
+    while( x.compare( m_modulus ) != Comparison::LessThan )
+        x -= m_modulus;
+
+    return x;
+}
+
+BigNum BarrettReducer::multiply( const BigNum & x, const BigNum & y ) const
+{
+    BigNum z( x * y );
+    reduce( z );
+    return z;
+}
+
+BigNum BarrettReducer::square( const BigNum & x ) const
+{
+    BigNum z( x );
+    z.square();
+    reduce( z );
+    return z;
+}
@@ -0,0 +1,32 @@
+#ifndef __BARRETT_REDUCER_H__
+#define __BARRETT_REDUCER_H__
+
+#include "BigNum.h"
+
+// Reduces values modulo a fixed modulus with Barrett reduction (HAC Algorithm 14.42). The
+// reciprocal mu = floor(b^2k / m), where m has k digits, is computed once when the reducer is
+// created. Each reduction after that takes two truncated multiplications and a few subtractions
+// instead of a full division. Unlike Montgomery reduction, this works for even moduli too.
+class BarrettReducer
+{
+public:
+    explicit BarrettReducer( const BigNum & modulus );
+
+    const BigNum & modulus() const { return m_modulus; }
+
+    // Reduces x modulo the modulus in place, giving a value in [0, m). Values in [0, b^2k), which
+    // includes all products of two reduced values, take the fast path. Anything else falls back to
+    // BigNum::mod.
+    BigNum & reduce( BigNum & x ) const;
+
+    // Computes x * y mod m and x^2 mod m for reduced x and y.
+    BigNum multiply( const BigNum & x, const BigNum & y ) const;
+    BigNum square( const BigNum & x ) const;
+
+private:
+    BigNum m_modulus;
+    BigNum m_mu;
+    size_t m_numDigits;
+};
+
+#endif
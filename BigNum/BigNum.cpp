@@ -2,59 +2,336 @@
 #include <stdexcept>
 
 #include "BigNum.h"
+#include "DigitArena.h"
+#include "Mpn.h"
+#include "NttMultiply.h"
 
 namespace
 {
 
 constexpr size_t BaseCapacity = 4;
 
+// Karatsuba only makes progress when the half size products are smaller than the original one. The
+// sum of two halves can carry into an extra digit, so this needs at least four digits per factor.
+constexpr size_t MinKaratsubaDigits = 4;
+
+// Same as above for Toom-3, where the evaluated thirds can grow by up to three digits.
+constexpr size_t MinToomDigits = 9;
+
+bool useKaratsuba( size_t lhsDigits, size_t rhsDigits )
+{
+    const size_t numDigits = std::min( lhsDigits, rhsDigits );
+    return numDigits >= KaratsubaMultiplyCutoff && numDigits >= MinKaratsubaDigits;
+}
+
+bool useToom( size_t lhsDigits, size_t rhsDigits )
+{
+    const size_t numDigits = std::min( lhsDigits, rhsDigits );
+    return numDigits >= ToomMultiplyCutoff && numDigits >= MinToomDigits;
+}
+
+bool useBurnikelZiegler( size_t dividendDigits, size_t divisorDigits )
+{
+    return divisorDigits >= BurnikelZieglerDivideCutoff &&
+        dividendDigits >= divisorDigits + BurnikelZieglerDivideCutoff;
+}
+
+bool useNtt( size_t lhsDigits, size_t rhsDigits )
+{
+    return std::min( lhsDigits, rhsDigits ) >= NttMultiplyCutoff &&
+        lhsDigits + rhsDigits <= nttMaxProductDigits();
+}
+
+// Decimal conversions work on chunks of as many decimal digits as fit in a single digit.
+#ifdef BIGNUM_64BIT_DIGITS
+constexpr size_t DecimalChunkDigits = 18;
+#else
+constexpr size_t DecimalChunkDigits = 9;
+#endif
+
+constexpr BigNum::digit_t powerOfTen( size_t exponent )
+{
+    return exponent == 0 ? 1 : 10 * powerOfTen( exponent - 1 );
 }
 
-BigNum::biterator::biterator( const BigNum & number ) : m_number( number )
+// Numbers with fewer chunks than this are converted one chunk at a time, which is quadratic but
+// faster than splitting them further.
+constexpr size_t DecimalBaseChunks = 32;
+
+int hexValue( char c )
+{
+    if( c >= '0' && c <= '9' )
+        return c - '0';
+    if( c >= 'a' && c <= 'f' )
+        return c - 'a' + 10;
+    if( c >= 'A' && c <= 'F' )
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+// Converts the decimal digits in [begin, end) by splitting them at the largest power of ten in
+// powers, i.e., 10^(DecimalChunkDigits * 2^i), that leaves digits on both sides, and combining the
+// two halves with a single multiplication.
+BigNum decimalToBigNum( const char * begin, const char * end, const std::vector<BigNum> & powers )
 {
-    if( m_number.isZero() )
+    const size_t length = static_cast<size_t>(end - begin);
+    BigNum result;
+
+    if( length <= DecimalChunkDigits * DecimalBaseChunks )
     {
-        m_iCurrentDigit = 0;
-        m_currentBitInDigitMask = 0;
+        BigNum chunk;
+        for( const char * chunkBegin = begin; chunkBegin < end; )
+        {
+            const size_t chunkLength = std::min<size_t>( DecimalChunkDigits, end - chunkBegin );
+            BigNum::digit_t value = 0;
+            for( size_t iChar = 0; iChar < chunkLength; ++iChar )
+                value = value * 10 + static_cast<BigNum::digit_t>(chunkBegin[iChar] - '0');
+
+            result *= powerOfTen( chunkLength );
+            chunk = value;
+            result += chunk;
+            chunkBegin += chunkLength;
+        }
+
+        return result;
     }
-    else
+
+    size_t iPower = 0;
+    while( iPower + 1 < powers.size() && (DecimalChunkDigits << (iPower + 1)) < length )
+        ++iPower;
+
+    const char * split = end - (DecimalChunkDigits << iPower);
+    result = decimalToBigNum( begin, split, powers ) * powers[iPower];
+    result += decimalToBigNum( split, end, powers );
+    return result;
+}
+
+}
+
+size_t KaratsubaMultiplyCutoff = 64;
+size_t ToomMultiplyCutoff = 192;
+size_t NttMultiplyCutoff = 3072;
+size_t BurnikelZieglerDivideCutoff = 16;
+
+BigNum::biterator::biterator( const BigNum & number, Order order ) :
+    m_number( number ), m_order( order ), m_iBeginBit( 0 ), m_iEndBit( number.numberBits() )
+{
+}
+
+BigNum::digit_t BigNum::biterator::nextBit()
+{
+    const size_t iBit = m_order == Order::MostSignificantFirst ? --m_iEndBit : m_iBeginBit++;
+    return m_number.m_digits[iBit / DigitBits] & (DigitOne << (iBit % DigitBits));
+}
+
+BigNum::digit_t BigNum::biterator::nextBits( size_t k )
+{
+    k = std::min( k, bitsLeft() );
+
+    if( m_order == Order::MostSignificantFirst )
     {
-        m_iCurrentDigit = m_number.m_numDigitsUsed - 1;
+        m_iEndBit -= k;
+        return bitsAt( m_iEndBit, k );
+    }
+
+    m_iBeginBit += k;
+    return bitsAt( m_iBeginBit - k, k );
+}
 
-        // If this is zero, it really means there are DigitBits number of bits in the leading digit.
-        size_t numLeadingDigitBits = m_number.numberBits() % DigitBits;
-        if( numLeadingDigitBits == 0 )
-            numLeadingDigitBits = DigitBits;
+size_t BigNum::biterator::skipZeros()
+{
+    const size_t initialBitsLeft = bitsLeft();
+
+    while( hasBits() )
+    {
+        // Look at the unread bits of the digit holding the next bit, stepping over the digit in one
+        // go if they are all zero.
+        if( m_order == Order::MostSignificantFirst )
+        {
+            const size_t iLastBit = m_iEndBit - 1;
+            const size_t iDigitBegin = std::max( iLastBit - iLastBit % DigitBits, m_iBeginBit );
+            const digit_t bits = bitsAt( iDigitBegin, m_iEndBit - iDigitBegin );
+            if( bits == 0 )
+            {
+                m_iEndBit = iDigitBegin;
+                continue;
+            }
+
+            size_t numBits = 0;
+            for( digit_t remaining = bits; remaining != 0; remaining >>= 1 )
+                ++numBits;
+
+            m_iEndBit = iDigitBegin + numBits;
+        }
+        else
+        {
+            const size_t iDigitEnd =
+                std::min( m_iBeginBit - m_iBeginBit % DigitBits + DigitBits, m_iEndBit );
+            const digit_t bits = bitsAt( m_iBeginBit, iDigitEnd - m_iBeginBit );
+            if( bits == 0 )
+            {
+                m_iBeginBit = iDigitEnd;
+                continue;
+            }
+
+            for( digit_t remaining = bits; (remaining & 1) == 0; remaining >>= 1 )
+                ++m_iBeginBit;
+        }
 
-        m_currentBitInDigitMask = DigitOne << (numLeadingDigitBits - 1);
+        break;
     }
+
+    return initialBitsLeft - bitsLeft();
 }
 
-BigNum::digit_t BigNum::biterator::nextBit()
+// Reads bits [iBit, iBit + k) of the number, which may straddle two digits. The range must lie
+// within the number, so the second digit is only touched when it is in use.
+BigNum::digit_t BigNum::biterator::bitsAt( size_t iBit, size_t k ) const
+{
+    if( k == 0 )
+        return 0;
+
+    const size_t iDigit = iBit / DigitBits;
+    const size_t shift = iBit % DigitBits;
+
+    word_t bits = m_number.m_digits[iDigit] >> shift;
+    if( shift + k > DigitBits )
+        bits |= word_t( m_number.m_digits[iDigit + 1] ) << (DigitBits - shift);
+
+    return digit_t( bits ) & ((DigitOne << k) - 1);
+}
+
+BigNum::DigitStorage::DigitStorage( const DigitStorage & other ) : DigitStorage()
+{
+    *this = other;
+}
+
+BigNum::DigitStorage::DigitStorage( DigitStorage && other ) : DigitStorage()
 {
-    digit_t value = m_number.m_digits[m_iCurrentDigit] & m_currentBitInDigitMask;
-    m_currentBitInDigitMask >>= 1;
+    stealFrom( other );
+}
+
+BigNum::DigitStorage & BigNum::DigitStorage::operator=( const DigitStorage & other )
+{
+    if( this != &other )
+    {
+        if( m_size < other.m_size )
+            resize( other.m_size );
+
+        std::copy( other.m_data, other.m_data + other.m_size, m_data );
+        std::fill( m_data + other.m_size, m_data + m_size, 0 );
+    }
+
+    return *this;
+}
+
+BigNum::DigitStorage & BigNum::DigitStorage::operator=( DigitStorage && other )
+{
+    if( this != &other )
+    {
+        release();
+        stealFrom( other );
+    }
+
+    return *this;
+}
+
+void BigNum::DigitStorage::resize( size_t newSize )
+{
+    if( newSize <= m_size )
+        return;
+
+    if( newSize <= InlineCapacity && isInline() )
+    {
+        std::fill( m_data + m_size, m_data + newSize, 0 );
+    }
+    else
+    {
+        DigitArena * arena = DigitArena::current();
+        digit_t * newData = (arena != nullptr) ?
+            static_cast<digit_t *>(arena->allocate( newSize * sizeof( digit_t ) )) :
+            new digit_t[newSize];
+
+        std::copy( m_data, m_data + m_size, newData );
+        std::fill( newData + m_size, newData + newSize, 0 );
+        release();
+        m_data = newData;
+        m_arena = arena;
+    }
+
+    m_size = newSize;
+}
 
-    if( m_currentBitInDigitMask == 0 && m_iCurrentDigit > 0 )
+void BigNum::DigitStorage::release()
+{
+    if( !isInline() )
     {
-        --m_iCurrentDigit;
-        m_currentBitInDigitMask = DigitOne << (DigitBits - 1);
+        if( m_arena != nullptr )
+            m_arena->deallocate( m_data, m_size * sizeof( digit_t ) );
+        else
+            delete[] m_data;
     }
 
-    return value;
+    m_data = m_inline;
+    m_size = 0;
+    m_arena = nullptr;
 }
 
+void BigNum::DigitStorage::stealFrom( DigitStorage & other )
+{
+    // Heap allocations can simply change owners. Inline digits have to be copied.
+    if( other.isInline() )
+    {
+        std::copy( other.m_data, other.m_data + other.m_size, m_inline );
+        m_data = m_inline;
+    }
+    else
+    {
+        m_data = other.m_data;
+        m_arena = other.m_arena;
+    }
+
+    m_size = other.m_size;
+    other.m_data = other.m_inline;
+    other.m_size = 0;
+    other.m_arena = nullptr;
+}
 
 BigNum::BigNum() : BigNum( BaseCapacity ) { }
 
 BigNum::BigNum( size_t capacity ) :
     m_negative( false ),
-    m_numDigitsUsed( 0 ),
-    m_digits( 0 )
+    m_numDigitsUsed( 0 )
 {
     grow( capacity );
 }
 
+BigNum::BigNum( const product_expr & expr ) :
+    BigNum( expr.lhs.m_numDigitsUsed + expr.rhs.m_numDigitsUsed + 1 )
+{
+    multiplyAccumulate( expr.lhs, expr.rhs, false );
+}
+
+BigNum::BigNum( const digit_product_expr & expr ) :
+    BigNum( expr.lhs.m_numDigitsUsed + 1 )
+{
+    multiplyAccumulate( expr.lhs, expr.rhs, false );
+}
+
+BigNum::BigNum( const multiply_add_expr & expr ) :
+    BigNum( expr.addend )
+{
+    multiplyAccumulate( expr.product.lhs, expr.product.rhs, expr.subtract );
+}
+
+BigNum BigNum::product_expr::mod( const BigNum & modulus ) const
+{
+    BigNum result( *this );
+    result.mod( modulus );
+    return result;
+}
+
 BigNum::BigNum( const std::vector<uint8_t> & digitData ) :
     BigNum( digitData.data(), digitData.size() ) { }
 
@@ -94,7 +371,7 @@ void BigNum::grow( size_t newCapacity )
     if( m_digits.size() >= newCapacity )
         return;
 
-    // Note: vector.resize zero-initializes newly inserted elements.
+    // Note: DigitStorage::resize zero-initializes newly added digits.
     newCapacity += (2 * BaseCapacity) - (newCapacity % BaseCapacity);
     m_digits.resize( newCapacity );
 }
@@ -124,27 +401,55 @@ void BigNum::loadBytes( const uint8_t * bytes, size_t count, bool preZero,
     if( count % swizzleSize != 0 )
         throw std::invalid_argument( "Swizzle size must be multiple of load size." );
 
+    // The loaded bytes end up below whatever this number held before, so the old value has to move
+    // up to make room for them.
     if( preZero )
         zero();
+    else
+        *this <<= 8 * count;
 
-    const auto computeByteOffset = swizzle ? computeByteOffsetSwizzle : computeByteOffsetNoSwizzle;
-    
-    for( size_t iByte = 0; iByte <= (count - swizzleSize); iByte += swizzleSize )
+    const size_t numDigits = (count * 8 + DigitBits - 1) / DigitBits;
+    grow( numDigits );
+
+    if( m_numDigitsUsed < numDigits )
+        std::fill( m_digits.begin() + m_numDigitsUsed, m_digits.begin() + numDigits, 0 );
+
+    // Bytes are most significant first, except that each group of swizzleSize bytes is reversed
+    // when swizzling. Walk them from the least significant end and pack eight bits at a time
+    // straight into the digits, which are known to be zero here.
+    word_t buffer = 0;
+    size_t bufferBits = 0;
+    size_t iDigit = 0;
+
+    for( size_t iGroup = count; iGroup > 0; iGroup -= swizzleSize )
     {
-        for( size_t swizzleOffset = 0; swizzleOffset < swizzleSize; ++swizzleOffset )
+        for( size_t swizzleOffset = swizzleSize; swizzleOffset > 0; --swizzleOffset )
         {
-            *this <<= 8;
-            const size_t iRead = iByte + computeByteOffset( swizzleSize, swizzleOffset );
-            m_digits[0] |= bytes[iRead];
-            ++m_numDigitsUsed;
+            const size_t iRead = iGroup - swizzleSize + (swizzle ?
+                computeByteOffsetSwizzle( swizzleSize, swizzleOffset - 1 ) :
+                computeByteOffsetNoSwizzle( swizzleSize, swizzleOffset - 1 ));
+
+            buffer |= static_cast<word_t>(bytes[iRead]) << bufferBits;
+            bufferBits += 8;
+
+            if( bufferBits >= DigitBits )
+            {
+                m_digits[iDigit++] |= static_cast<digit_t>(buffer & DigitMask);
+                buffer >>= DigitBits;
+                bufferBits -= DigitBits;
+            }
         }
     }
 
+    if( bufferBits > 0 )
+        m_digits[iDigit++] |= static_cast<digit_t>(buffer);
+
+    m_numDigitsUsed = std::max( m_numDigitsUsed, iDigit );
     clamp();
 }
 
 void BigNum::storeBytes( uint8_t * bytes, size_t count,
-    bool swizzle, size_t swizzleSize )
+    bool swizzle, size_t swizzleSize ) const
 {
     if( bytes == nullptr )
         return;
@@ -152,18 +457,250 @@ void BigNum::storeBytes( uint8_t * bytes, size_t count,
     if( count % swizzleSize != 0 )
         throw std::invalid_argument( "Swizzle size must be multiple of store size." );
 
-    BigNum x( *this );
-    const auto computeByteOffset = swizzle ? computeByteOffsetSwizzle : computeByteOffsetNoSwizzle;
+    // The reverse of loadBytes. Unpack eight bits at a time from the least significant digit up.
+    // Bytes past the most significant digit are written as zero.
+    word_t buffer = 0;
+    size_t bufferBits = 0;
+    size_t iDigit = 0;
 
-    for( size_t iByte = 0; iByte <= (count - swizzleSize); iByte += swizzleSize )
+    for( size_t iGroup = 0; iGroup < count; iGroup += swizzleSize )
     {
         for( size_t swizzleOffset = 0; swizzleOffset < swizzleSize; ++swizzleOffset )
         {
-            const size_t iWrite = iByte + computeByteOffset( swizzleSize, swizzleOffset );
-            bytes[count - 1 - iWrite] = static_cast<uint8_t>(x.m_digits[0] & 0xFF);
-            x >>= 8;
+            if( bufferBits < 8 && iDigit < m_numDigitsUsed )
+            {
+                buffer |= static_cast<word_t>(m_digits[iDigit++]) << bufferBits;
+                bufferBits += DigitBits;
+            }
+
+            const size_t iWrite = iGroup + (swizzle ?
+                computeByteOffsetSwizzle( swizzleSize, swizzleOffset ) :
+                computeByteOffsetNoSwizzle( swizzleSize, swizzleOffset ));
+
+            bytes[count - 1 - iWrite] = static_cast<uint8_t>(buffer & 0xFF);
+            buffer >>= 8;
+            bufferBits = bufferBits > 8 ? bufferBits - 8 : 0;
+        }
+    }
+}
+
+std::vector<BigNum> BigNum::loadBlocks( const uint8_t * bytes, size_t count, size_t blockSize,
+    bool swizzle, size_t swizzleSize )
+{
+    if( blockSize == 0 || count % blockSize != 0 )
+        throw std::invalid_argument( "Load size must be a multiple of block size." );
+
+    const size_t numBlocks = count / blockSize;
+    std::vector<BigNum> blocks( numBlocks, BigNum( (blockSize * 8 + DigitBits - 1) / DigitBits ) );
+
+    for( size_t iBlock = 0; iBlock < numBlocks; ++iBlock )
+        blocks[iBlock].loadBytes( bytes + iBlock * blockSize, blockSize, true, swizzle, swizzleSize );
+
+    return blocks;
+}
+
+void BigNum::storeBlocks( const std::vector<BigNum> & blocks, uint8_t * bytes, size_t blockSize,
+    bool swizzle, size_t swizzleSize )
+{
+    for( size_t iBlock = 0; iBlock < blocks.size(); ++iBlock )
+        blocks[iBlock].storeBytes( bytes + iBlock * blockSize, blockSize, swizzle, swizzleSize );
+}
+
+BigNum BigNum::fromHex( const std::string & hex )
+{
+    size_t iFirst = (!hex.empty() && hex[0] == '-') ? 1 : 0;
+    if( hex.size() > iFirst + 1 && hex[iFirst] == '0' && (hex[iFirst + 1] == 'x' || hex[iFirst + 1] == 'X') )
+        iFirst += 2;
+
+    if( iFirst == hex.size() )
+        throw std::invalid_argument( "Hex string has no digits." );
+
+    // Pack four bits per hex digit into the number's digits, starting from the least significant
+    // end of the string.
+    const size_t numDigits = ((hex.size() - iFirst) * 4 + DigitBits - 1) / DigitBits;
+    BigNum result( numDigits );
+    word_t buffer = 0;
+    size_t bufferBits = 0;
+    size_t iDigit = 0;
+
+    for( size_t iChar = hex.size(); iChar > iFirst; --iChar )
+    {
+        const int value = hexValue( hex[iChar - 1] );
+        if( value < 0 )
+            throw std::invalid_argument( "Invalid hex digit." );
+
+        buffer |= static_cast<word_t>(value) << bufferBits;
+        bufferBits += 4;
+
+        if( bufferBits >= DigitBits )
+        {
+            result.m_digits[iDigit++] = static_cast<digit_t>(buffer & DigitMask);
+            buffer >>= DigitBits;
+            bufferBits -= DigitBits;
+        }
+    }
+
+    if( bufferBits > 0 )
+        result.m_digits[iDigit++] = static_cast<digit_t>(buffer);
+
+    result.m_numDigitsUsed = iDigit;
+    result.clamp();
+    result.m_negative = (iFirst > 0 && hex[0] == '-') && !result.isZero();
+    return result;
+}
+
+BigNum BigNum::fromDecimal( const std::string & decimal )
+{
+    const size_t iFirst = (!decimal.empty() && decimal[0] == '-') ? 1 : 0;
+    if( iFirst == decimal.size() )
+        throw std::invalid_argument( "Decimal string has no digits." );
+
+    for( size_t iChar = iFirst; iChar < decimal.size(); ++iChar )
+    {
+        if( decimal[iChar] < '0' || decimal[iChar] > '9' )
+            throw std::invalid_argument( "Invalid decimal digit." );
+    }
+
+    // Powers of ten 10^(DecimalChunkDigits * 2^i), each the square of the one before, for as long
+    // as they are needed to split the string in half.
+    const size_t length = decimal.size() - iFirst;
+    std::vector<BigNum> powers;
+    powers.emplace_back();
+    powers.back() = powerOfTen( DecimalChunkDigits );
+
+    while( (DecimalChunkDigits << powers.size()) < length )
+        powers.push_back( ::square( powers.back() ) );
+
+    BigNum result( decimalToBigNum( decimal.data() + iFirst, decimal.data() + decimal.size(), powers ) );
+    result.m_negative = (iFirst > 0) && !result.isZero();
+    return result;
+}
+
+std::string BigNum::toHex() const
+{
+    if( isZero() )
+        return "0";
+
+    // Unpack four bits at a time, least significant first, then reverse.
+    static const char HexDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve( (m_numDigitsUsed * DigitBits + 3) / 4 + 1 );
+    word_t buffer = 0;
+    size_t bufferBits = 0;
+
+    for( size_t iDigit = 0; iDigit < m_numDigitsUsed; ++iDigit )
+    {
+        buffer |= static_cast<word_t>(m_digits[iDigit]) << bufferBits;
+        bufferBits += DigitBits;
+
+        for( ; bufferBits >= 4; bufferBits -= 4 )
+        {
+            hex.push_back( HexDigits[static_cast<size_t>(buffer & 0xF)] );
+            buffer >>= 4;
+        }
+    }
+
+    if( bufferBits > 0 )
+        hex.push_back( HexDigits[static_cast<size_t>(buffer)] );
+
+    while( hex.back() == '0' )
+        hex.pop_back();
+
+    if( m_negative )
+        hex.push_back( '-' );
+
+    return std::string( hex.rbegin(), hex.rend() );
+}
+
+std::string BigNum::toDecimal() const
+{
+    if( isZero() )
+        return "0";
+
+    BigNum x( *this );
+    x.abs();
+
+    // Powers of ten 10^(DecimalChunkDigits * 2^i) up to the first one whose square is larger than
+    // x, so that each split below leaves a quotient and remainder less than the next power down.
+    std::vector<BigNum> powers;
+    powers.emplace_back();
+    powers.back() = powerOfTen( DecimalChunkDigits );
+
+    while( x.m_numDigitsUsed > DecimalBaseChunks &&
+        2 * powers.back().m_numDigitsUsed - 1 <= x.m_numDigitsUsed )
+    {
+        powers.push_back( ::square( powers.back() ) );
+    }
+
+    std::string decimal;
+    if( m_negative )
+        decimal.push_back( '-' );
+
+    x.appendDecimal( powers, powers.size(), 0, decimal );
+    return decimal;
+}
+
+// Appends the decimal digits of this number to decimal, padded with leading zeros to width digits,
+// using the first numPowers entries of powers. This number is destroyed in the process.
+void BigNum::appendDecimal( const std::vector<BigNum> & powers, size_t numPowers, size_t width,
+    std::string & decimal )
+{
+    if( numPowers == 0 || m_numDigitsUsed <= DecimalBaseChunks )
+    {
+        // Peel off one chunk of decimal digits at a time, least significant first.
+        std::string digits;
+        while( !isZero() )
+        {
+            digit_t chunk = divideByDigit( powerOfTen( DecimalChunkDigits ) );
+            for( size_t iChar = 0; iChar < DecimalChunkDigits && (chunk != 0 || !isZero()); ++iChar )
+            {
+                digits.push_back( static_cast<char>('0' + chunk % 10) );
+                chunk /= 10;
+            }
         }
+
+        if( digits.size() < width )
+            decimal.append( width - digits.size(), '0' );
+
+        decimal.append( digits.rbegin(), digits.rend() );
+        return;
+    }
+
+    const BigNum & power = powers[numPowers - 1];
+    const size_t lowWidth = DecimalChunkDigits << (numPowers - 1);
+
+    if( compareMagnitude( power ) == Comparison::LessThan )
+    {
+        appendDecimal( powers, numPowers - 1, width, decimal );
+        return;
     }
+
+    BigNum q;
+    BigNum r;
+    divide( power, q, r );
+    q.appendDecimal( powers, numPowers - 1, width > lowWidth ? width - lowWidth : 0, decimal );
+    r.appendDecimal( powers, numPowers - 1, lowWidth, decimal );
+}
+
+void BigNum::loadDigits( const digit_t * digits, size_t count )
+{
+    zero();
+    grow( count );
+    std::copy( digits, digits + count, m_digits.begin() );
+    m_numDigitsUsed = count;
+    clamp();
+}
+
+BigNum::digit_t * BigNum::writeDigits( size_t count )
+{
+    grow( count );
+    return m_digits.begin();
+}
+
+void BigNum::finishDigits( size_t count )
+{
+    m_numDigitsUsed = count;
+    clamp();
 }
 
 Comparison BigNum::compareMagnitude( const BigNum & other ) const
@@ -218,56 +755,19 @@ BigNum & BigNum::multiplyByTwo()
     if( m_digits.size() < minCapacity )
         grow( minCapacity );
 
-    const size_t oldNumDigitsUsed = m_numDigitsUsed;
-    size_t iDigit;
-    digit_t carry = 0;
-
-    for( iDigit = 0; iDigit < m_numDigitsUsed; ++iDigit )
-    {
-        constexpr digit_t nextCarryShift = DigitBits - DigitOne;
-        const digit_t nextCarry = m_digits[iDigit] >> nextCarryShift;
-        m_digits[iDigit] = ((m_digits[iDigit] << DigitOne) | carry) & DigitMask;
-        carry = nextCarry;
-    }
-
+    const digit_t carry = mpn::lshift( m_digits.begin(), m_digits.data(), m_numDigitsUsed, 1 );
     if( carry != 0 )
     {
-        m_digits[iDigit] = carry;
+        m_digits[m_numDigitsUsed] = carry;
         ++m_numDigitsUsed;
     }
 
-    if( m_numDigitsUsed < (oldNumDigitsUsed - 1) )
-    {
-        for( iDigit = m_numDigitsUsed; iDigit < oldNumDigitsUsed; ++iDigit )
-            m_digits[iDigit] = 0;
-    }
-
     return *this;
 }
 
 BigNum & BigNum::divideByTwo()
 {
-    const size_t oldNumDigitsUsed = m_numDigitsUsed;
-    size_t iDigit;
-    size_t riDigit;
-    digit_t carry = 0;
-
-    for( iDigit = 0, riDigit = m_numDigitsUsed - 1;
-        iDigit < m_numDigitsUsed;
-        ++iDigit, --riDigit )
-    {
-        constexpr digit_t carryShift = DigitBits - DigitOne;
-        const digit_t nextCarry = m_digits[riDigit] & DigitOne;
-        m_digits[riDigit] = (m_digits[riDigit] >> DigitOne) | (carry << carryShift);
-        carry = nextCarry;
-    }
-
-    if( m_numDigitsUsed < (oldNumDigitsUsed - 1) )
-    {
-        for( iDigit = m_numDigitsUsed; iDigit < oldNumDigitsUsed; ++iDigit )
-            m_digits[iDigit] = 0;
-    }
-
+    mpn::rshift( m_digits.begin(), m_digits.data(), m_numDigitsUsed, 1 );
     clamp();
     return *this;
 }
@@ -360,7 +860,7 @@ BigNum & BigNum::mod2b( size_t b )
 
     // Clear out the appropriate bits in the digit that is not completely in/out of the modulus.
     const size_t iBoundaryDigit = b / DigitBits;
-    const size_t residualMask = (DigitOne << (b % DigitBits)) - DigitOne;
+    const digit_t residualMask = (DigitOne << (b % DigitBits)) - DigitOne;
     m_digits[iBoundaryDigit] &= residualMask;
 
     clamp();
@@ -396,75 +896,162 @@ BigNum & BigNum::operator=( digit_t value )
     return *this;
 }
 
-BigNum & BigNum::operator+=( const BigNum & rhs )
+BigNum & BigNum::operator=( const product_expr & expr )
 {
-    if( m_negative == rhs.m_negative )
-    {
-        unsignedAddEquals( rhs );
-    }
-    else if( compareMagnitude( rhs ) == Comparison::LessThan )
+    if( &expr.lhs == this || &expr.rhs == this )
     {
-        *this = unsignedSubtract( rhs, *this );
+        *this = BigNum( expr );
     }
     else
     {
-        unsignedSubtractEquals( rhs );
+        zero();
+        multiplyAccumulate( expr.lhs, expr.rhs, false );
     }
 
     return *this;
 }
 
-BigNum & BigNum::operator-=( const BigNum & rhs )
+BigNum & BigNum::operator=( const digit_product_expr & expr )
 {
-    if( m_negative != rhs.m_negative )
-    {
-        unsignedAddEquals( rhs );
-    }
-    else if( compareMagnitude( rhs ) != Comparison::LessThan )
+    if( &expr.lhs == this )
     {
-        unsignedSubtractEquals( rhs );
+        *this *= expr.rhs;
     }
     else
     {
-        const bool newNegative = !m_negative;
-        *this = unsignedSubtract( rhs, *this );
-        m_negative = newNegative;
+        zero();
+        multiplyAccumulate( expr.lhs, expr.rhs, false );
     }
 
     return *this;
 }
 
-BigNum & BigNum::operator*=( const BigNum & rhs )
+BigNum & BigNum::operator=( const multiply_add_expr & expr )
 {
-    // This only supports the baseline multiplier from BigNum Math and none of the fancier methods.
-    m_negative = (m_negative != rhs.m_negative);
-    baselineMultiply( rhs, m_numDigitsUsed + rhs.m_numDigitsUsed + 1 );
-    return *this;
-}
+    if( &expr.addend == this )
+    {
+        multiplyAccumulate( expr.product.lhs, expr.product.rhs, expr.subtract );
+    }
+    else if( &expr.product.lhs == this || &expr.product.rhs == this )
+    {
+        *this = BigNum( expr );
+    }
+    else
+    {
+        *this = expr.addend;
+        multiplyAccumulate( expr.product.lhs, expr.product.rhs, expr.subtract );
+    }
+
+    return *this;
+}
+
+BigNum & BigNum::operator+=( const BigNum & rhs )
+{
+    if( m_negative == rhs.m_negative )
+    {
+        unsignedAddEquals( rhs );
+    }
+    else if( compareMagnitude( rhs ) == Comparison::LessThan )
+    {
+        *this = unsignedSubtract( rhs, *this );
+    }
+    else
+    {
+        unsignedSubtractEquals( rhs );
+    }
+
+    return *this;
+}
+
+BigNum & BigNum::operator-=( const BigNum & rhs )
+{
+    if( m_negative != rhs.m_negative )
+    {
+        unsignedAddEquals( rhs );
+    }
+    else if( compareMagnitude( rhs ) != Comparison::LessThan )
+    {
+        unsignedSubtractEquals( rhs );
+    }
+    else
+    {
+        const bool newNegative = !m_negative;
+        *this = unsignedSubtract( rhs, *this );
+        m_negative = newNegative;
+    }
+
+    return *this;
+}
+
+BigNum & BigNum::operator+=( const product_expr & rhs )
+{
+    multiplyAccumulate( rhs.lhs, rhs.rhs, false );
+    return *this;
+}
+
+BigNum & BigNum::operator+=( const digit_product_expr & rhs )
+{
+    multiplyAccumulate( rhs.lhs, rhs.rhs, false );
+    return *this;
+}
+
+BigNum & BigNum::operator-=( const product_expr & rhs )
+{
+    multiplyAccumulate( rhs.lhs, rhs.rhs, true );
+    return *this;
+}
+
+BigNum & BigNum::operator-=( const digit_product_expr & rhs )
+{
+    multiplyAccumulate( rhs.lhs, rhs.rhs, true );
+    return *this;
+}
+
+BigNum & BigNum::operator*=( const BigNum & rhs )
+{
+    const bool negative = (m_negative != rhs.m_negative);
+
+    if( useNtt( m_numDigitsUsed, rhs.m_numDigitsUsed ) )
+        nttMultiply( rhs );
+    else if( useToom( m_numDigitsUsed, rhs.m_numDigitsUsed ) )
+        toomMultiply( rhs );
+    else if( useKaratsuba( m_numDigitsUsed, rhs.m_numDigitsUsed ) )
+        karatsubaMultiply( rhs );
+    else
+        baselineMultiply( rhs, m_numDigitsUsed + rhs.m_numDigitsUsed + 1 );
+
+    m_negative = negative && !isZero();
+    return *this;
+}
 
 BigNum & BigNum::operator*=( digit_t rhs )
 {
     const size_t oldNumDigitsUsed = m_numDigitsUsed;
     grow( oldNumDigitsUsed + 1 );
 
+    m_digits[oldNumDigitsUsed] = mpn::mul_1( m_digits.begin(), m_digits.data(), oldNumDigitsUsed,
+        rhs );
     m_numDigitsUsed = oldNumDigitsUsed + 1;
-    digit_t carry = 0;
-    constexpr auto digitMask = static_cast<word_t>(DigitMask);
-    constexpr auto digitBits = static_cast<word_t>(DigitBits);
-
-    for( size_t iDigit = 0; iDigit < oldNumDigitsUsed; ++iDigit )
-    {
-        const word_t r = static_cast<word_t>(carry) +
-            static_cast<word_t>(m_digits[iDigit]) *
-            static_cast<word_t>(rhs);
 
-        m_digits[iDigit] = static_cast<digit_t>(r & digitMask);
-        carry = static_cast<digit_t>(r >> digitBits);
-    }
+    clamp();
+    return *this;
+}
 
-    m_digits[oldNumDigitsUsed] = carry;
+// Squares this number. This picks a multiplier the same way operator*= does, but each one has a
+// squaring variant that exploits the symmetry of the product, except for Toom-3 which simply
+// multiplies the number by itself. The NTT multiplier detects squaring itself and saves a transform.
+BigNum & BigNum::square()
+{
+    if( useNtt( m_numDigitsUsed, m_numDigitsUsed ) )
+        nttMultiply( *this );
+    else if( useToom( m_numDigitsUsed, m_numDigitsUsed ) )
+        toomMultiply( *this );
+    else if( useKaratsuba( m_numDigitsUsed, m_numDigitsUsed ) )
+        karatsubaSquare();
+    else
+        baselineSquare();
 
-    clamp();
+    m_negative = false;
     return *this;
 }
 
@@ -492,16 +1079,8 @@ BigNum & BigNum::operator<<=( size_t numBits )
 
     if( numBits != 0 )
     {
-        const digit_t mask = (DigitOne << numBits) - DigitOne;
-        const digit_t carryShift = DigitBits - numBits;
-        digit_t carry = 0;
-
-        for( size_t iDigit = 0; iDigit < m_numDigitsUsed; ++iDigit )
-        {
-            const digit_t nextCarry = (m_digits[iDigit] >> carryShift) & mask;
-            m_digits[iDigit] = ((m_digits[iDigit] << numBits) | carry) & DigitMask;
-            carry = nextCarry;
-        }
+        const digit_t carry = mpn::lshift( m_digits.begin(), m_digits.data(), m_numDigitsUsed,
+            numBits );
 
         if( carry > 0 )
         {
@@ -526,20 +1105,7 @@ BigNum & BigNum::operator>>=( size_t numBits )
     numBits %= DigitBits;
 
     if( numBits != 0 )
-    {
-        const digit_t mask = (DigitOne << numBits) - DigitOne;
-        const digit_t carryShift = DigitBits - numBits;
-        digit_t carry = 0;
-
-        for( size_t iDigit = 0, riDigit = m_numDigitsUsed - 1;
-            iDigit < m_numDigitsUsed;
-            ++iDigit, --riDigit )
-        {
-            const digit_t nextCarry = m_digits[riDigit] & mask;
-            m_digits[riDigit] = (m_digits[riDigit] >> numBits) | (carry << carryShift);
-            carry = nextCarry;
-        }
-    }
+        mpn::rshift( m_digits.begin(), m_digits.data(), m_numDigitsUsed, numBits );
 
     clamp();
     return *this;
@@ -547,178 +1113,497 @@ BigNum & BigNum::operator>>=( size_t numBits )
 
 BigNum & BigNum::unsignedAddEquals( const BigNum & rhs )
 {
-    size_t maxUsed;
-    size_t minUsed;
-    const BigNum * maxNum;
+    const size_t maxUsed = std::max( m_numDigitsUsed, rhs.m_numDigitsUsed );
+    if( m_digits.size() < maxUsed + 1 )
+        grow( maxUsed + 1 );
 
-    if( m_numDigitsUsed > rhs.m_numDigitsUsed )
+    // mpn::add wants the longer addend first. Either way the sum is written over this number.
+    digit_t carry;
+    if( m_numDigitsUsed >= rhs.m_numDigitsUsed )
     {
-        minUsed = rhs.m_numDigitsUsed;
-        maxUsed = m_numDigitsUsed;
-        maxNum = this;
+        carry = mpn::add( m_digits.begin(), m_digits.data(), m_numDigitsUsed,
+            rhs.m_digits.data(), rhs.m_numDigitsUsed );
     }
     else
     {
-        minUsed = m_numDigitsUsed;
-        maxUsed = rhs.m_numDigitsUsed;
-        maxNum = &rhs;
+        carry = mpn::add( m_digits.begin(), rhs.m_digits.data(), rhs.m_numDigitsUsed,
+            m_digits.data(), m_numDigitsUsed );
     }
 
-    if( m_digits.size() < maxUsed + 1 )
-        grow( maxUsed + 1 );
-
-    const size_t oldNumDigitsUsed = m_numDigitsUsed;
+    m_digits[maxUsed] = carry;
     m_numDigitsUsed = maxUsed + 1;
-    digit_t carry = 0;
 
-    size_t iDigit;
-    for( iDigit = 0; iDigit < minUsed; ++iDigit )
-    {
-        // Sum the current digits from both addends plus the current carry.
-        m_digits[iDigit] += rhs.m_digits[iDigit] + carry;
+    clamp();
+    return *this;
+}
 
-        // Get the carry bit for this iteration's sum.
-        carry = m_digits[iDigit] >> DigitBits;
+BigNum & BigNum::unsignedSubtractEquals( const BigNum & rhs )
+{
+    // This routine assumes this number is equal to or greater in magnitude than the right hand
+    // side, so there is no borrow out of the most significant digit.
+    mpn::sub( m_digits.begin(), m_digits.data(), m_numDigitsUsed,
+        rhs.m_digits.data(), rhs.m_numDigitsUsed );
 
-        // Clear out the carry bit from this iteration's sum.
-        m_digits[iDigit] &= DigitMask;
-    }
+    clamp();
+    return *this;
+}
+
+BigNum & BigNum::baselineMultiply( const BigNum & rhs, size_t numDigits )
+{
+    // The product can't be written over this number's digits while they are still being read, so
+    // it goes into a temporary. For all but very large products the temporary uses inline storage.
+    BigNum temp( numDigits );
+    mpn::mul_columns( temp.m_digits.begin(), m_digits.data(), m_numDigitsUsed,
+        rhs.m_digits.data(), rhs.m_numDigitsUsed, 0, numDigits );
+
+    temp.m_numDigitsUsed = numDigits;
+    temp.clamp();
+    m_numDigitsUsed = temp.m_numDigitsUsed;
+    m_digits = std::move( temp.m_digits );
+
+    return *this;
+}
+
+BigNum & BigNum::nttMultiply( const BigNum & rhs )
+{
+    // Same as baselineMultiply, except that the product of the digits comes from the NTT. Passing
+    // this number's own digits for both factors when squaring lets it skip a forward transform.
+    const size_t numDigits = m_numDigitsUsed + rhs.m_numDigitsUsed;
+    BigNum temp( numDigits );
+    ::nttMultiply( temp.m_digits.begin(), m_digits.data(), m_numDigitsUsed,
+        rhs.m_digits.data(), rhs.m_numDigitsUsed );
+
+    temp.m_numDigitsUsed = numDigits;
+    temp.clamp();
+    m_numDigitsUsed = temp.m_numDigitsUsed;
+    m_digits = std::move( temp.m_digits );
+
+    return *this;
+}
+
+// Truncated product for when only the low digits are needed, e.g., a product mod b^numDigits.
+// Columns at or above numDigits are never computed.
+BigNum & BigNum::multiplyLow( const BigNum & rhs, size_t numDigits )
+{
+    const bool negative = (m_negative != rhs.m_negative);
+    numDigits = std::min( numDigits, m_numDigitsUsed + rhs.m_numDigitsUsed );
 
-    if( minUsed != maxUsed )
+    if( useKaratsuba( m_numDigitsUsed, rhs.m_numDigitsUsed ) )
     {
-        for( ; iDigit < maxUsed; ++iDigit )
-        {
-            // Sum the current digit from longer addend plus the current carry.
-            m_digits[iDigit] = maxNum->m_digits[iDigit] + carry;
-        
-            // Get the carry bit for this iteration's sum.
-            carry = m_digits[iDigit] >> DigitBits;
-            
-            // Clear out the carry bit from this iteration's sum.
-            m_digits[iDigit] &= DigitMask;
-        }
+        // The subquadratic multipliers can't skip columns, but they still beat computing half of
+        // the columns the quadratic way.
+        *this *= rhs;
+        abs();
+        mod2b( numDigits * DigitBits );
+    }
+    else
+    {
+        BigNum temp( numDigits );
+        mpn::mul_columns( temp.m_digits.begin(), m_digits.data(), m_numDigitsUsed,
+            rhs.m_digits.data(), rhs.m_numDigitsUsed, 0, numDigits );
+
+        temp.m_numDigitsUsed = numDigits;
+        temp.clamp();
+        m_numDigitsUsed = temp.m_numDigitsUsed;
+        m_digits = std::move( temp.m_digits );
     }
 
-    m_digits[maxUsed] = carry;
+    m_negative = negative && !isZero();
+    return *this;
+}
+
+// Truncated product for when only the high digits are needed, e.g., a quotient estimate. Columns
+// below numDigits are never computed and their carries are dropped, so the result can fall short
+// of the product divided by b^numDigits by less than numDigits * b.
+BigNum & BigNum::multiplyHigh( const BigNum & rhs, size_t numDigits )
+{
+    const bool negative = (m_negative != rhs.m_negative);
+    const size_t productDigits = m_numDigitsUsed + rhs.m_numDigitsUsed;
 
-    if( oldNumDigitsUsed > maxUsed )
+    if( numDigits >= productDigits )
     {
-        // If needed, zero out the most significant digits that don't contribute to the sum.
-        //
-        // NOTE: I haven't verified this, but since this is implemented as basically a +=
-        // operation, and thus (I'm pretty sure) oldNumDigitsUsed will either be less than or
-        // equal to maxUsed, I think this loop can't get executed. Similarly, I'm not convinced
-        // the final clamp operation is needed. This would need additional checking though.
-        //
-        for( iDigit = maxUsed + 1; iDigit < oldNumDigitsUsed; ++iDigit )
-            m_digits[iDigit] = 0;
+        zero();
+        return *this;
     }
 
+    if( useKaratsuba( m_numDigitsUsed, rhs.m_numDigitsUsed ) )
+    {
+        *this *= rhs;
+    }
+    else
+    {
+        BigNum temp( productDigits );
+        mpn::mul_columns( temp.m_digits.begin(), m_digits.data(), m_numDigitsUsed,
+            rhs.m_digits.data(), rhs.m_numDigitsUsed, numDigits, productDigits );
+
+        temp.m_numDigitsUsed = productDigits;
+        m_numDigitsUsed = productDigits;
+        m_digits = std::move( temp.m_digits );
+    }
+
+    rightDigitShift( numDigits );
     clamp();
+    m_negative = negative && !isZero();
     return *this;
 }
 
-BigNum & BigNum::unsignedSubtractEquals( const BigNum & rhs )
+// Computes this += lhs * rhs, or this -= lhs * rhs if subtract is set, without first forming the
+// product in a temporary.
+void BigNum::multiplyAccumulate( const BigNum & lhs, const BigNum & rhs, bool subtract )
 {
-    size_t minUsed = rhs.m_numDigitsUsed;
-    size_t maxUsed = m_numDigitsUsed;
+    if( &lhs == this || &rhs == this )
+    {
+        // The digits of this number are overwritten as the product is accumulated, so work on a
+        // copy if it is also one of the factors.
+        BigNum result( *this );
+        result.multiplyAccumulate( lhs, rhs, subtract );
+        *this = result;
+        return;
+    }
 
-    if( m_digits.size() < maxUsed )
-        grow( maxUsed );
+    if( useNtt( lhs.m_numDigitsUsed, rhs.m_numDigitsUsed ) ||
+        useToom( lhs.m_numDigitsUsed, rhs.m_numDigitsUsed ) ||
+        useKaratsuba( lhs.m_numDigitsUsed, rhs.m_numDigitsUsed ) )
+    {
+        // Large products are cheaper to compute separately with a subquadratic multiplier.
+        BigNum product( lhs );
+        product *= rhs;
 
-    const size_t oldNumDigitsUsed = maxUsed;
-    digit_t carry = 0;
+        if( subtract )
+            *this -= product;
+        else
+            *this += product;
 
-    size_t iDigit;
-    for( iDigit = 0; iDigit < minUsed; ++iDigit )
-    {
-        // Subtract the subtrahend from the minuend and subtract out the previous carry.
-        m_digits[iDigit] = m_digits[iDigit] - rhs.m_digits[iDigit] - carry;
+        return;
+    }
 
-        // Get the carry bit for this iteration's difference. This optimization from BigNum Math
-        // is an optimization that pulls out the carry bit that propagated to the most significant
-        // bit in the computed difference. This only works on machines that perform 2's complement
-        // arithmetic, which is valid for x86/x64 and RISC-V.
-        carry = m_digits[iDigit] >> (DigitBitSize - DigitOne);
+    const bool negativeProduct = ((lhs.m_negative != rhs.m_negative) != subtract);
 
-        // Clear out the carry bits from this iteration's difference.
-        m_digits[iDigit] &= DigitMask;
+    if( isZero() && !lhs.isZero() && !rhs.isZero() )
+    {
+        // Nothing to accumulate into, so the product can be written straight into this number.
+        const size_t numDigits = lhs.m_numDigitsUsed + rhs.m_numDigitsUsed;
+        grow( numDigits );
+        mpn::mul_basecase( m_digits.begin(), lhs.m_digits.data(), lhs.m_numDigitsUsed,
+            rhs.m_digits.data(), rhs.m_numDigitsUsed );
+
+        m_numDigitsUsed = numDigits;
+        m_negative = negativeProduct;
+        clamp();
+        return;
     }
 
-    if( minUsed < maxUsed )
+    accumulateRows( lhs, rhs.m_digits.data(), rhs.m_numDigitsUsed, negativeProduct );
+}
+
+void BigNum::multiplyAccumulate( const BigNum & lhs, digit_t rhs, bool subtract )
+{
+    if( &lhs == this )
     {
-        for( ; iDigit < maxUsed; ++iDigit )
-        {
-            // This routine assumes this number is equal to or greater in magnitude than the right
-            // hand side, so we always subtract out the carry from this number's upper digits.
-            m_digits[iDigit] -= carry;
+        BigNum result( *this );
+        result.multiplyAccumulate( lhs, rhs, subtract );
+        *this = result;
+        return;
+    }
+
+    accumulateRows( lhs, &rhs, rhs == 0 ? 0 : 1, lhs.m_negative != subtract );
+}
 
-            // Get the carry bit for this iteration's difference. This optimization from BigNum Math
-            // is an optimization that pulls out the carry bit that propagated to the most significant
-            // bit in the computed difference. This only works on machines that perform 2's complement
-            // arithmetic, which is valid for x86/x64 and RISC-V.
-            carry = m_digits[iDigit] >> (DigitBitSize - DigitOne);
+// Adds (or subtracts, if negativeProduct differs from the sign of this number) the product of lhs
+// and the given digits into this number one row of partial products at a time. If the product is
+// being subtracted and turns out to be larger in magnitude than this number, the digits are left
+// holding b^n - |result|, which is corrected with a single negation pass at the end.
+void BigNum::accumulateRows( const BigNum & lhs, const digit_t * rhs, size_t rhsDigits,
+    bool negativeProduct )
+{
+    if( lhs.isZero() || rhsDigits == 0 )
+        return;
 
-            // Clear out the carry bits from this iteration's difference.
-            m_digits[iDigit] &= DigitMask;
+    if( isZero() )
+        m_negative = negativeProduct;
+
+    const size_t numDigits = std::max( m_numDigitsUsed, lhs.m_numDigitsUsed + rhsDigits ) + 1;
+    grow( numDigits );
+    std::fill( m_digits.begin() + m_numDigitsUsed, m_digits.begin() + numDigits, 0 );
+
+    const bool subtract = (negativeProduct != m_negative);
+    digit_t borrow = 0;
+
+    for( size_t iDigit = 0; iDigit < lhs.m_numDigitsUsed; ++iDigit )
+    {
+        digit_t * row = m_digits.begin() + iDigit;
+        const size_t rowDigits = numDigits - iDigit;
+
+        if( subtract )
+        {
+            const digit_t rowBorrow = mpn::submul_1( row, rhs, rhsDigits, lhs.m_digits[iDigit] );
+            borrow += mpn::sub_1( row + rhsDigits, row + rhsDigits, rowDigits - rhsDigits,
+                rowBorrow );
+        }
+        else
+        {
+            const digit_t rowCarry = mpn::addmul_1( row, rhs, rhsDigits, lhs.m_digits[iDigit] );
+            mpn::add_1( row + rhsDigits, row + rhsDigits, rowDigits - rhsDigits, rowCarry );
         }
     }
 
-    if( oldNumDigitsUsed > maxUsed )
+    if( borrow != 0 )
     {
-        // I believe this loop can't be executed simply because this basically implements a -=
-        // operation, and this number is assumed to be one with a larger magnitude. Similarly with
-        // the final clamp operation. This would need additional verification.
-        for( ; iDigit < oldNumDigitsUsed; ++iDigit )
-            m_digits[iDigit] = 0;
+        // Negate the digits, i.e., compute b^n - x by complementing every digit and adding one.
+        digit_t carry = 1;
+        for( size_t iDigit = 0; iDigit < numDigits; ++iDigit )
+        {
+            m_digits[iDigit] = (DigitMask - m_digits[iDigit]) + carry;
+            carry = m_digits[iDigit] >> DigitBits;
+            m_digits[iDigit] &= DigitMask;
+        }
+
+        m_negative = !m_negative;
     }
 
+    m_numDigitsUsed = numDigits;
     clamp();
+}
+
+// Based on the Karatsuba multiplier in section 5.3.4 of BigNum Math. Computes the product of the
+// magnitudes of this number and rhs. Each factor is split into halves x = x1 * b^B + x0, and the
+// product is assembled from the three half size products x0 * y0, x1 * y1 and (x1 + x0)(y1 + y0).
+// The half size products go back through the usual multiplication dispatch, so they recurse into
+// this routine until they drop below KaratsubaMultiplyCutoff.
+BigNum & BigNum::karatsubaMultiply( const BigNum & rhs )
+{
+    const size_t B = std::min( m_numDigitsUsed, rhs.m_numDigitsUsed ) / 2;
+
+    BigNum x0;
+    BigNum x1;
+    BigNum y0;
+    BigNum y1;
+    splitDigits( B, x0, x1 );
+    rhs.splitDigits( B, y0, y1 );
+
+    BigNum x0y0( x0 * y0 );
+    BigNum x1y1( x1 * y1 );
+
+    // Compute (x1 + x0)(y1 + y0) - x0y0 - x1y1, which is x1y0 + x0y1.
+    x1 += x0;
+    y1 += y0;
+    BigNum middle( x1 * y1 );
+    middle -= x0y0;
+    middle -= x1y1;
+
+    *this = x0y0;
+    *this += middle.leftDigitShift( B );
+    *this += x1y1.leftDigitShift( 2 * B );
     return *this;
 }
 
-BigNum & BigNum::baselineMultiply( const BigNum & rhs, size_t numDigits )
+// Based on the Toom-Cook 3-way multiplier in LibTomMath, which uses the evaluation points and
+// interpolation sequence from Bodrato and Zanoni. Computes the product of the magnitudes of this
+// number and rhs. Each factor is split into thirds x = x2 * b^2B + x1 * b^B + x0, i.e., treated as
+// a polynomial in b^B. The product polynomial has degree four, so it is determined by its values at
+// the five points 0, 1, -1, 2 and infinity, which take five products of a third of the size.
+BigNum & BigNum::toomMultiply( const BigNum & rhs )
 {
+    const size_t B = std::min( m_numDigitsUsed, rhs.m_numDigitsUsed ) / 3;
+
+    BigNum x0;
+    BigNum x1;
+    BigNum x2;
+    BigNum y0;
+    BigNum y1;
+    BigNum y2;
+    BigNum upper;
+    splitDigits( B, x0, upper );
+    upper.splitDigits( B, x1, x2 );
+    rhs.splitDigits( B, y0, upper );
+    upper.splitDigits( B, y1, y2 );
+
+    // S0 = r(0) and S4 = r(infinity).
+    BigNum s0( x0 * y0 );
+    BigNum s4( x2 * y2 );
+
+    // S1 = r(1) = (x2 + x1 + x0)(y2 + y1 + y0).
+    BigNum t1( x2 );
+    t1 += x1;
+    BigNum t2( y2 );
+    t2 += y1;
+    BigNum s1( (t1 + x0) * (t2 + y0) );
+
+    // S2 = r(2) = (4x2 + 2x1 + x0)(4y2 + 2y1 + y0).
+    t1 += x2;
+    t1.multiplyByTwo();
+    t1 += x0;
+    t2 += y2;
+    t2.multiplyByTwo();
+    t2 += y0;
+    BigNum s2( t1 * t2 );
+
+    // S3 = r(-1) = (x2 - x1 + x0)(y2 - y1 + y0). These factors can be negative.
+    t1 = x2;
+    t1 -= x1;
+    t1 += x0;
+    t2 = y2;
+    t2 -= y1;
+    t2 += y0;
+    BigNum s3( t1 * t2 );
+
+    // Interpolate the coefficients of r. Every division here is exact.
+    s2 -= s3;
+    s2.exactDivide( 3 );
+    s3 = s1 - s3;
+    s3.divideByTwo();
+    s1 -= s0;
+    s2 -= s1;
+    s2.divideByTwo();
+    s1 -= s3;
+    s1 -= s4;
+    s2 -= s4;
+    s2 -= s4;
+    s3 -= s2;
+
+    // The coefficients of b^0 .. b^4B are now S0, S3, S1, S2 and S4 respectively.
+    *this = s0;
+    *this += s3.leftDigitShift( B );
+    *this += s1.leftDigitShift( 2 * B );
+    *this += s2.leftDigitShift( 3 * B );
+    *this += s4.leftDigitShift( 4 * B );
+    return *this;
+}
+
+// Squares this number with the quadratic squaring kernel, which computes each cross product of
+// digits only once.
+BigNum & BigNum::baselineSquare()
+{
+    const size_t numDigits = 2 * m_numDigitsUsed;
+
     BigNum temp( numDigits );
+    mpn::sqr_basecase( temp.m_digits.begin(), m_digits.data(), m_numDigitsUsed );
+
     temp.m_numDigitsUsed = numDigits;
+    temp.clamp();
+    m_numDigitsUsed = temp.m_numDigitsUsed;
+    m_digits = std::move( temp.m_digits );
 
-    for( size_t iDigitThis = 0; iDigitThis < m_numDigitsUsed; ++iDigitThis )
+    return *this;
+}
+
+// Karatsuba squaring from section 5.3.5 of BigNum Math. Same as karatsubaMultiply with both
+// factors equal, so all three half size products are squares.
+BigNum & BigNum::karatsubaSquare()
+{
+    const size_t B = m_numDigitsUsed / 2;
+
+    BigNum x0;
+    BigNum x1;
+    splitDigits( B, x0, x1 );
+
+    BigNum x0x0( x0 );
+    x0x0.square();
+    BigNum x1x1( x1 );
+    x1x1.square();
+
+    // Compute (x1 + x0)^2 - x0^2 - x1^2, which is 2 * x1 * x0.
+    BigNum middle( x1 );
+    middle += x0;
+    middle.square();
+    middle -= x0x0;
+    middle -= x1x1;
+
+    *this = x0x0;
+    *this += middle.leftDigitShift( B );
+    *this += x1x1.leftDigitShift( 2 * B );
+    return *this;
+}
+
+// Divides the magnitude of this number by an odd divisor that is known to divide it exactly. Rather
+// than dividing from the most significant digit down, this multiplies each digit by the inverse of
+// the divisor modulo b, working up from the least significant digit as in Jebelean's method, so no
+// division instructions are needed.
+BigNum & BigNum::exactDivide( digit_t divisor )
+{
+    constexpr auto digitMask = static_cast<word_t>(DigitMask);
+    constexpr auto digitBits = static_cast<word_t>(DigitBits);
+    const auto inverse = static_cast<word_t>(mpn::binvert_1( divisor ));
+    const auto divisorWord = static_cast<word_t>(divisor);
+    word_t carry = 0;
+
+    for( size_t iDigit = 0; iDigit < m_numDigitsUsed; ++iDigit )
     {
-        digit_t carry = 0;
-        const size_t numDigitsRhs = std::min( rhs.m_numDigitsUsed, numDigits - iDigitThis );
+        // Subtract what the previous quotient digits took out of this digit, borrowing from the
+        // next digit if needed. The quotient digit is whatever clears the remaining value mod b.
+        const auto digit = static_cast<word_t>(m_digits[iDigit]);
+        const word_t borrow = digit < carry ? 1 : 0;
+        const word_t value = digit + (borrow << digitBits) - carry;
+        const word_t quotient = (value * inverse) & digitMask;
+
+        m_digits[iDigit] = static_cast<digit_t>(quotient);
+        carry = ((quotient * divisorWord) >> digitBits) + borrow;
+    }
 
-        if( numDigitsRhs < 1 )
-            break;
+    clamp();
+    return *this;
+}
 
-        for( size_t iDigitRhs = 0; iDigitRhs < numDigitsRhs; ++iDigitRhs )
-        {
-            const size_t iDigitTemp = iDigitThis + iDigitRhs;
-            const word_t product = (static_cast<word_t>(temp.m_digits[iDigitTemp]) +
-                static_cast<word_t>(m_digits[iDigitThis]) *
-                static_cast<word_t>(rhs.m_digits[iDigitRhs]) +
-                static_cast<word_t>(carry));
-
-            temp.m_digits[iDigitTemp] = product & static_cast<word_t>(DigitMask);
-            carry = static_cast<digit_t>(product >> static_cast<word_t>(DigitBits));
-        }
+// Divides the magnitude of this number by a single digit in place, most significant digit first.
+// Returns the remainder.
+BigNum::digit_t BigNum::divideByDigit( digit_t divisor )
+{
+    const auto divisorWord = static_cast<word_t>(divisor);
+    word_t remainder = 0;
 
-        if( (iDigitThis + numDigitsRhs) < numDigits )
-            temp.m_digits[iDigitThis + numDigitsRhs] = carry;
+    for( size_t iDigit = m_numDigitsUsed; iDigit > 0; --iDigit )
+    {
+        const word_t value = (remainder << DigitBits) | m_digits[iDigit - 1];
+        m_digits[iDigit - 1] = static_cast<digit_t>(value / divisorWord);
+        remainder = value % divisorWord;
     }
 
-    temp.clamp();
-    m_numDigitsUsed = temp.m_numDigitsUsed;
-    m_digits = std::move( temp.m_digits );
+    clamp();
+    return static_cast<digit_t>(remainder);
+}
 
+// Splits the magnitude of this number into its least significant numLowDigits digits and the
+// remaining high digits.
+void BigNum::splitDigits( size_t numLowDigits, BigNum & low, BigNum & high ) const
+{
+    const size_t lowDigits = std::min( numLowDigits, m_numDigitsUsed );
+    low.loadDigits( m_digits.data(), lowDigits );
+    high.loadDigits( m_digits.data() + lowDigits, m_numDigitsUsed - lowDigits );
+}
+
+// Based on Algorithm 14.32 in Handbook of Applied Cryptography. Computes this * R^-1 mod m for
+// R = b^n, where n is the number of digits in m and mInv = -m^-1 mod b. This number must be
+// nonnegative and less than m * R. Unlike montgomery_multiply, this reduces a product that was
+// already computed, so the product itself can come from any of the multipliers.
+BigNum & BigNum::montgomeryReduce( const BigNum & m, digit_t mInv )
+{
+    const size_t n = m.m_numDigitsUsed;
+    const size_t numDigits = 2 * n + 1;
+
+    grow( numDigits );
+    std::fill( m_digits.begin() + m_numDigitsUsed, m_digits.begin() + numDigits, 0 );
+
+    mpn::redc_1( m_digits.begin(), m_digits.begin(), m.m_digits.data(), n, mInv );
+
+    m_numDigitsUsed = n;
+    clamp();
     return *this;
 }
 
-// Based on the BigNum Math's enhanced version of HAC's Algorithm 14.20.
 void BigNum::divide( const BigNum & rhs, BigNum & q, BigNum & r )
 {
     if( rhs.isZero() )
         throw std::invalid_argument( "Cannot divide by zero." );
 
+    if( useBurnikelZiegler( m_numDigitsUsed, rhs.m_numDigitsUsed ) )
+        burnikelZieglerDivide( rhs, q, r );
+    else
+        baselineDivide( rhs, q, r );
+}
+
+// Based on the BigNum Math's enhanced version of HAC's Algorithm 14.20.
+void BigNum::baselineDivide( const BigNum & rhs, BigNum & q, BigNum & r ) const
+{
     if( compareMagnitude( rhs ) == Comparison::LessThan )
     {
         r = *this;
@@ -726,7 +1611,9 @@ void BigNum::divide( const BigNum & rhs, BigNum & q, BigNum & r )
         return;
     }
 
-    // Setup the quotient.
+    // Setup the quotient. The digits are filled in one at a time below, so any previous value has
+    // to be cleared first.
+    q.zero();
     q.grow( m_numDigitsUsed + 2 );
     q.m_numDigitsUsed = m_numDigitsUsed + 2;
 
@@ -740,8 +1627,9 @@ void BigNum::divide( const BigNum & rhs, BigNum & q, BigNum & r )
 
     // Normalize inputs. Compute how much we need to shift the divisor by to have its most
     // significant bit in the DigitBits position of its leading digit. Use this amount to
-    // shift both our divisor and dividend.
-    size_t normShift = y.numberBits() & DigitMask;
+    // shift both our divisor and dividend. This keeps each quotient digit estimate below within
+    // two of the true quotient digit.
+    size_t normShift = y.numberBits() % DigitBits;
     if( normShift < (DigitBits - 1) )
     {
         normShift = DigitBits - 1 - normShift;
@@ -777,7 +1665,7 @@ void BigNum::divide( const BigNum & rhs, BigNum & q, BigNum & r )
         // Estimate the current quotient digit.
         auto & currentQuotientDigit = q.m_digits[iDigit - t - 1];
 
-        if( x.m_digits[iDigit] == y.m_digits[iDigit] )
+        if( x.m_digits[iDigit] == y.m_digits[t] )
         {
             currentQuotientDigit = DigitRadix - 1;
         }
@@ -840,6 +1728,152 @@ void BigNum::divide( const BigNum & rhs, BigNum & q, BigNum & r )
     r = x >> normShift;
 }
 
+// Recursive division from Burnikel and Ziegler, "Fast Recursive Division", with the same signs for
+// the quotient and remainder as baselineDivide. The dividend is cut into blocks of n digits, where
+// n is the size of the divisor rounded up to j * 2^k for some j below BurnikelZieglerDivideCutoff.
+// Each block is then divided by the divisor with divideTwoByOne, which splits the problem in half
+// k times before falling back to schoolbook division. The divisions in between only take
+// multiplications of half the size, so this runs at the speed of the multiplier instead of in
+// quadratic time.
+void BigNum::burnikelZieglerDivide( const BigNum & rhs, BigNum & q, BigNum & r ) const
+{
+    size_t halvings = 1;
+    while( rhs.m_numDigitsUsed / halvings >= BurnikelZieglerDivideCutoff )
+        halvings *= 2;
+
+    const size_t n = (rhs.m_numDigitsUsed + halvings - 1) / halvings * halvings;
+
+    // Normalize the divisor to exactly n digits with the top bit of its leading digit set, which
+    // keeps the quotient estimates in divideThreeByTwo within two of the true quotient.
+    const size_t leadingBits = rhs.numberBits() % DigitBits;
+    const size_t normShift = (n - rhs.m_numDigitsUsed) * DigitBits +
+        (leadingBits == 0 ? 0 : DigitBits - leadingBits);
+
+    BigNum b( rhs );
+    b.abs();
+    b <<= normShift;
+
+    BigNum a( *this );
+    a.abs();
+    a <<= normShift;
+
+    // Number of n digit blocks in the dividend, with at least one leading zero bit in the top
+    // block so that the top two blocks are less than b * b^n.
+    const size_t numBlocks = std::max<size_t>( a.numberBits() / (n * DigitBits) + 1, 2 );
+
+    BigNum z( a );
+    z.rightDigitShift( (numBlocks - 2) * n );
+
+    BigNum quotient;
+    BigNum blockQuotient;
+    BigNum remainder;
+    BigNum block;
+
+    for( size_t iBlock = numBlocks - 2; ; --iBlock )
+    {
+        divideTwoByOne( z, b, n, blockQuotient, remainder );
+        quotient.leftDigitShift( n );
+        quotient += blockQuotient;
+
+        if( iBlock == 0 )
+            break;
+
+        const size_t firstDigit = std::min( (iBlock - 1) * n, a.m_numDigitsUsed );
+        block.loadDigits( a.m_digits.data() + firstDigit,
+            std::min( n, a.m_numDigitsUsed - firstDigit ) );
+
+        z = remainder;
+        z.leftDigitShift( n );
+        z += block;
+    }
+
+    remainder >>= normShift;
+
+    q = quotient;
+    q.m_negative = (m_negative != rhs.m_negative) && !q.isZero();
+    r = remainder;
+    r.m_negative = m_negative && !r.isZero();
+}
+
+// Algorithm 1 of Burnikel and Ziegler. Divides a < b * b^n by b, which has n digits and is
+// normalized, giving q < b^n and r < b. Both a and b are nonnegative.
+void BigNum::divideTwoByOne( const BigNum & a, const BigNum & b, size_t n, BigNum & q, BigNum & r )
+{
+    if( (n % 2) != 0 || n < BurnikelZieglerDivideCutoff )
+    {
+        a.baselineDivide( b, q, r );
+        return;
+    }
+
+    // Split a into its upper three quarters and its lowest quarter, and divide each in turn as a
+    // three by two division.
+    const size_t half = n / 2;
+    BigNum a4;
+    BigNum upper;
+    a.splitDigits( half, a4, upper );
+
+    BigNum q1;
+    BigNum r1;
+    divideThreeByTwo( upper, b, half, q1, r1 );
+
+    r1.leftDigitShift( half );
+    r1 += a4;
+    divideThreeByTwo( r1, b, half, q, r );
+
+    q1.leftDigitShift( half );
+    q += q1;
+}
+
+// Algorithm 2 of Burnikel and Ziegler. Divides a < b * b^n, which has up to 3n digits, by b, which
+// has 2n digits and is normalized, giving q < b^n and r < b. Both a and b are nonnegative.
+void BigNum::divideThreeByTwo( const BigNum & a, const BigNum & b, size_t n, BigNum & q, BigNum & r )
+{
+    BigNum a3;
+    BigNum a12;
+    a.splitDigits( n, a3, a12 );
+
+    BigNum b2;
+    BigNum b1;
+    b.splitDigits( n, b2, b1 );
+
+    // Estimate the quotient from the leading digits, a12 / b1. When the top n digits of a are at
+    // least b1, the quotient is just below b^n and is capped there instead.
+    BigNum a1( a12 );
+    a1.rightDigitShift( n );
+
+    BigNum one;
+    one = 1;
+
+    BigNum r1;
+    if( a1.compare( b1 ) == Comparison::LessThan )
+    {
+        divideTwoByOne( a12, b1, n, q, r1 );
+    }
+    else
+    {
+        q = one;
+        q.leftDigitShift( n );
+        q -= one;
+
+        // r1 = a12 - b1 * (b^n - 1)
+        r1 = a12;
+        r1 += b1;
+        r1 -= ::leftDigitShift( b1, n );
+    }
+
+    // r = r1 * b^n + a3 - q * b2, corrected by adding back b while it is negative.
+    r = r1;
+    r.leftDigitShift( n );
+    r += a3;
+    r -= q * b2;
+
+    while( r.m_negative )
+    {
+        r += b;
+        q -= one;
+    }
+}
+
 BigNum abs( const BigNum & x )
 {
     BigNum y( x );
@@ -868,6 +1902,27 @@ BigNum divideByTwo( const BigNum & x )
     return y;
 }
 
+BigNum square( const BigNum & x )
+{
+    BigNum y( x );
+    y.square();
+    return y;
+}
+
+BigNum multiplyLow( const BigNum & x, const BigNum & y, size_t numDigits )
+{
+    BigNum z( x );
+    z.multiplyLow( y, numDigits );
+    return z;
+}
+
+BigNum multiplyHigh( const BigNum & x, const BigNum & y, size_t numDigits )
+{
+    BigNum z( x );
+    z.multiplyHigh( y, numDigits );
+    return z;
+}
+
 BigNum leftDigitShift( const BigNum & x, size_t numDigits )
 {
     BigNum y( x );
@@ -2,8 +2,22 @@
 #define __BIG_NUM_H__
 
 #include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 
+class DigitArena;
+
+// Defining BIGNUM_64BIT_DIGITS switches BigNum from 32-bit digits holding 31 bits of the number
+// to 64-bit digits holding 63 bits of the number. This roughly halves the number of digits needed
+// to hold a value of a given size and quarters the number of digit products computed by the
+// quadratic multiplication and reduction loops. The double precision word type becomes a 128-bit
+// integer, so this mode is only available on compilers that provide unsigned __int128.
+#if defined( BIGNUM_64BIT_DIGITS ) && !defined( __SIZEOF_INT128__ )
+#error "BIGNUM_64BIT_DIGITS requires compiler support for unsigned __int128."
+#endif
+
 enum class Comparison
 {
     LessThan,
@@ -15,21 +29,82 @@ enum class Comparison
 class BigNum
 {
 public:
+#ifdef BIGNUM_64BIT_DIGITS
+    typedef uint64_t digit_t;
+    typedef unsigned __int128 word_t;
+#else
     typedef uint32_t digit_t;
     typedef uint64_t word_t;
+#endif
 
+    // Walks the bits of a number, either from the most significant bit down (the default, as used
+    // by left-to-right exponentiation) or from the least significant bit up. Bits can be taken one
+    // at a time, k at a time as an integer for windowed methods, and runs of zero bits can be
+    // skipped in bulk.
     struct biterator
     {
-        explicit biterator( const BigNum & number );
+        enum class Order
+        {
+            MostSignificantFirst,
+            LeastSignificantFirst
+        };
+
+        explicit biterator( const BigNum & number, Order order = Order::MostSignificantFirst );
 
-        bool hasBits() const { return m_currentBitInDigitMask > 0; }
+        bool hasBits() const { return m_iBeginBit < m_iEndBit; }
+        size_t bitsLeft() const { return m_iEndBit - m_iBeginBit; }
 
+        // Returns the next bit, masked in place within its digit, so the result is only meaningful
+        // when compared to zero.
         digit_t nextBit();
 
+        // Returns the next min( k, bitsLeft() ) bits as an integer, where k is at most DigitBits.
+        // The bits keep their relative significance in the number whichever order they are read in.
+        digit_t nextBits( size_t k );
+
+        // Skips over zero bits until the next bit is a one or no bits remain, and returns the number
+        // of bits skipped.
+        size_t skipZeros();
+
     private:
+        digit_t bitsAt( size_t iBit, size_t k ) const;
+
         const BigNum & m_number;
-        digit_t m_currentBitInDigitMask;
-        size_t m_iCurrentDigit;
+        const Order m_order;
+
+        // The bits not yet read are [m_iBeginBit, m_iEndBit).
+        size_t m_iBeginBit;
+        size_t m_iEndBit;
+    };
+
+    // Expressions built by the multiplication operators. Rather than computing a product into a
+    // fresh temporary, these record their operands so that the product can be computed directly
+    // into the BigNum that finally receives it. Sums and differences involving a product, such as
+    // a + b * c or a - b * c, are likewise accumulated into the destination in a single pass over
+    // the digits of the product.
+    //
+    // Expressions only hold references to their operands, so they must be consumed by the full
+    // expression that created them. Do not store them (e.g., with auto).
+    struct product_expr
+    {
+        const BigNum & lhs;
+        const BigNum & rhs;
+
+        // Computes the product directly into the result and then reduces it by the given modulus.
+        BigNum mod( const BigNum & modulus ) const;
+    };
+
+    struct digit_product_expr
+    {
+        const BigNum & lhs;
+        digit_t rhs;
+    };
+
+    struct multiply_add_expr
+    {
+        const BigNum & addend;
+        product_expr product;
+        bool subtract;
     };
 
 public:
@@ -38,6 +113,10 @@ public:
     explicit BigNum( const std::vector<uint8_t> & digitData );
     BigNum( const uint8_t * digitData, size_t numberBytes,
         bool swizzle = false, size_t swizzleSize = 1 );
+    BigNum( const BigNum & other ) = default;
+    BigNum( const product_expr & expr );
+    BigNum( const digit_product_expr & expr );
+    BigNum( const multiply_add_expr & expr );
 
     size_t numberDigits() const { return m_numDigitsUsed;  }
     digit_t getDigit( size_t iDigit ) const { return m_digits[iDigit]; }
@@ -45,7 +124,10 @@ public:
     size_t numberBits() const;
     size_t numberBytes() const;
 
-    biterator createBiterator() const { return biterator( *this ); }
+    biterator createBiterator( biterator::Order order = biterator::Order::MostSignificantFirst ) const
+    {
+        return biterator( *this, order );
+    }
 
     void grow( size_t newCapacity );
     void clamp();
@@ -55,8 +137,34 @@ public:
         bool swizzle = false, size_t swizzleSize = 1 );
 
     void storeBytes( uint8_t * bytes, size_t count,
+        bool swizzle = false, size_t swizzleSize = 1 ) const;
+
+    // Bulk versions of loadBytes and storeBytes for an array of consecutive blocks of blockSize
+    // bytes each, e.g., the blocks of an RSA message.
+    static std::vector<BigNum> loadBlocks( const uint8_t * bytes, size_t count, size_t blockSize,
+        bool swizzle = false, size_t swizzleSize = 1 );
+    static void storeBlocks( const std::vector<BigNum> & blocks, uint8_t * bytes, size_t blockSize,
         bool swizzle = false, size_t swizzleSize = 1 );
 
+    void loadDigits( const digit_t * digits, size_t count );
+
+    // Raw access to the digits for use with the span functions in Mpn.h. readDigits returns the
+    // numberDigits() digits in use. writeDigits makes room for count digits and returns them for
+    // the caller to fill in, after which finishDigits sets how many digits are in use and trims
+    // leading zeros. The sign is left as it was.
+    const digit_t * readDigits() const { return m_digits.data(); }
+    digit_t * writeDigits( size_t count );
+    void finishDigits( size_t count );
+
+    // Conversions to and from strings of hex or decimal digits, with an optional leading '-'. Hex
+    // input may also start with "0x". Hex output uses lowercase digits without a prefix. Both hex
+    // conversions run in linear time. The decimal ones split the number in half recursively using
+    // powers of ten, so they run at the speed of multiplication and division.
+    static BigNum fromHex( const std::string & hex );
+    static BigNum fromDecimal( const std::string & decimal );
+    std::string toHex() const;
+    std::string toDecimal() const;
+
     bool isZero() const { return m_numDigitsUsed == 0; }
     bool isEven() const { return isZero() || (m_digits[0] & 1) == 0; }
     bool isOdd() const { return !isEven(); }
@@ -69,6 +177,14 @@ public:
     BigNum & negate();
     BigNum & multiplyByTwo();
     BigNum & divideByTwo();
+    BigNum & square();
+
+    // Truncated products. multiplyLow keeps the numDigits least significant digits of the product.
+    // multiplyHigh computes the product divided by b^numDigits without the low columns, which makes
+    // it an underestimate by less than numDigits * b. Both are cheaper than a full product when the
+    // quadratic multiplier would be used.
+    BigNum & multiplyLow( const BigNum & rhs, size_t numDigits );
+    BigNum & multiplyHigh( const BigNum & rhs, size_t numDigits );
     
     BigNum & leftDigitShift( size_t numDigits );
     BigNum & rightDigitShift( size_t numDigits );
@@ -76,8 +192,13 @@ public:
     BigNum & mod( const BigNum & modulus );
     BigNum & mod2b( size_t b );
 
+    BigNum & montgomeryReduce( const BigNum & m, digit_t mInv );
+
     BigNum & operator=( const BigNum & other );
     BigNum & operator=( digit_t value );
+    BigNum & operator=( const product_expr & expr );
+    BigNum & operator=( const digit_product_expr & expr );
+    BigNum & operator=( const multiply_add_expr & expr );
 
     BigNum & operator+=( const BigNum & rhs );
     friend BigNum operator+( BigNum lhs, const BigNum & rhs )
@@ -86,6 +207,26 @@ public:
         return lhs;
     }
 
+    BigNum & operator+=( const product_expr & rhs );
+    friend multiply_add_expr operator+( const BigNum & lhs, const product_expr & rhs )
+    {
+        return multiply_add_expr{ lhs, rhs, false };
+    }
+
+    friend multiply_add_expr operator+( const product_expr & lhs, const BigNum & rhs )
+    {
+        return multiply_add_expr{ rhs, lhs, false };
+    }
+
+    friend BigNum operator+( const product_expr & lhs, const product_expr & rhs )
+    {
+        BigNum result( lhs );
+        result += rhs;
+        return result;
+    }
+
+    BigNum & operator+=( const digit_product_expr & rhs );
+
     BigNum & operator-=( const BigNum & rhs );
     friend BigNum operator-( BigNum lhs, const BigNum & rhs )
     {
@@ -93,18 +234,31 @@ public:
         return lhs;
     }
 
+    BigNum & operator-=( const product_expr & rhs );
+    friend multiply_add_expr operator-( const BigNum & lhs, const product_expr & rhs )
+    {
+        return multiply_add_expr{ lhs, rhs, true };
+    }
+
+    friend BigNum operator-( const product_expr & lhs, const product_expr & rhs )
+    {
+        BigNum result( lhs );
+        result -= rhs;
+        return result;
+    }
+
+    BigNum & operator-=( const digit_product_expr & rhs );
+
     BigNum & operator*=( const BigNum & rhs );
-    friend BigNum operator*( BigNum lhs, const BigNum & rhs )
+    friend product_expr operator*( const BigNum & lhs, const BigNum & rhs )
     {
-        lhs *= rhs;
-        return lhs;
+        return product_expr{ lhs, rhs };
     }
 
     BigNum & operator*=( digit_t rhs );
-    friend BigNum operator*( BigNum lhs, digit_t rhs )
+    friend digit_product_expr operator*( const BigNum & lhs, digit_t rhs )
     {
-        lhs *= rhs;
-        return lhs;
+        return digit_product_expr{ lhs, rhs };
     }
 
     BigNum & operator/=( const BigNum & rhs );
@@ -144,23 +298,98 @@ private:
     }
 
     BigNum & baselineMultiply( const BigNum & rhs, size_t numDigits );
+    BigNum & karatsubaMultiply( const BigNum & rhs );
+    BigNum & toomMultiply( const BigNum & rhs );
+    BigNum & nttMultiply( const BigNum & rhs );
+    BigNum & baselineSquare();
+    BigNum & karatsubaSquare();
+
+    BigNum & exactDivide( digit_t divisor );
+    digit_t divideByDigit( digit_t divisor );
+    void appendDecimal( const std::vector<BigNum> & powers, size_t numPowers, size_t width,
+        std::string & decimal );
+
+    void splitDigits( size_t numLowDigits, BigNum & low, BigNum & high ) const;
+
+    void multiplyAccumulate( const BigNum & lhs, const BigNum & rhs, bool subtract );
+    void multiplyAccumulate( const BigNum & lhs, digit_t rhs, bool subtract );
+    void accumulateRows( const BigNum & lhs, const digit_t * rhs, size_t rhsDigits,
+        bool negativeProduct );
 
     void divide( const BigNum & rhs, BigNum & q, BigNum & r );
+    void baselineDivide( const BigNum & rhs, BigNum & q, BigNum & r ) const;
+    void burnikelZieglerDivide( const BigNum & rhs, BigNum & q, BigNum & r ) const;
+    static void divideTwoByOne( const BigNum & a, const BigNum & b, size_t n, BigNum & q, BigNum & r );
+    static void divideThreeByTwo( const BigNum & a, const BigNum & b, size_t n, BigNum & q,
+        BigNum & r );
 
     static size_t computeByteOffsetNoSwizzle( size_t swizzleSize, size_t swizzleOffset ) { return swizzleOffset;  }
     static size_t computeByteOffsetSwizzle( size_t swizzleSize, size_t swizzleOffset ) { return swizzleSize - 1 - swizzleOffset; }
 
 private:
+    // Holds the digits of a BigNum. Up to InlineCapacity digits are kept in a buffer inside the
+    // storage object itself. Growing past that moves the digits into a heap allocation, which comes
+    // from the calling thread's current DigitArena if there is one. Like the std::vector this
+    // replaces, digits added by resize are zero-initialized and the storage never shrinks.
+    //
+    // By default the inline buffer holds a 4096-bit number along with the extra digits grow()
+    // reserves, so the numbers involved in RSA operations up to that key size never touch the heap.
+    // Define BIGNUM_INLINE_DIGITS to choose a different number of inline digits.
+    class DigitStorage
+    {
+    public:
+#ifdef BIGNUM_INLINE_DIGITS
+        static constexpr size_t InlineCapacity = BIGNUM_INLINE_DIGITS;
+#else
+        static constexpr size_t ValueBitsPerDigit = CHAR_BIT * sizeof( digit_t ) - 1;
+        static constexpr size_t InlineCapacity = (4096 + ValueBitsPerDigit - 1) / ValueBitsPerDigit + 8;
+#endif
+
+        DigitStorage() : m_data( m_inline ), m_size( 0 ), m_arena( nullptr ) { }
+        DigitStorage( const DigitStorage & other );
+        DigitStorage( DigitStorage && other );
+        ~DigitStorage() { release(); }
+
+        DigitStorage & operator=( const DigitStorage & other );
+        DigitStorage & operator=( DigitStorage && other );
+
+        size_t size() const { return m_size; }
+        bool isInline() const { return m_data == m_inline; }
+
+        digit_t & operator[]( size_t i ) { return m_data[i]; }
+        const digit_t & operator[]( size_t i ) const { return m_data[i]; }
+
+        digit_t * begin() { return m_data; }
+        digit_t * end() { return m_data + m_size; }
+        const digit_t * data() const { return m_data; }
+
+        void resize( size_t newSize );
+
+    private:
+        void release();
+        void stealFrom( DigitStorage & other );
+
+        digit_t * m_data;
+        size_t m_size;
+        DigitArena * m_arena;
+        digit_t m_inline[InlineCapacity];
+    };
+
     bool m_negative;
     size_t m_numDigitsUsed;
-    std::vector<digit_t> m_digits;
+    DigitStorage m_digits;
 };
 
 constexpr  BigNum::digit_t DigitOne = static_cast<BigNum::digit_t>(1);
 
 // Number of bits in a digit contributing to the value of that digit. If this value is x, then the
-// radix of a BigNum is 2^x .
+// radix of a BigNum is 2^x . One bit of every digit is left unused so that the carry out of a
+// digit sum or the borrow out of a digit difference can be read directly from that digit.
+#ifdef BIGNUM_64BIT_DIGITS
+constexpr BigNum::digit_t DigitBits = 63;
+#else
 constexpr BigNum::digit_t DigitBits = 31;
+#endif
 
 // Radix for a digit. This is 2^DigitBits.
 constexpr BigNum::digit_t DigitRadix = DigitOne << DigitBits;
@@ -171,10 +400,29 @@ constexpr BigNum::digit_t DigitMask = DigitRadix - DigitOne;
 // Number of bits in a single precision digit.
 constexpr BigNum::digit_t DigitBitSize = CHAR_BIT * sizeof( BigNum::digit_t );
 
+// Number of digits both factors of a product need before multiplication switches from the baseline
+// multiplier to Karatsuba multiplication. This can be tuned for the target machine.
+extern size_t KaratsubaMultiplyCutoff;
+
+// Number of digits both factors of a product need before multiplication switches from Karatsuba to
+// Toom-Cook 3-way multiplication. This should be well above KaratsubaMultiplyCutoff.
+extern size_t ToomMultiplyCutoff;
+
+// Number of digits both factors of a product need before multiplication switches from Toom-Cook
+// 3-way multiplication to NTT multiplication. Products too large for the NTT stay with Toom-3.
+extern size_t NttMultiplyCutoff;
+
+// Number of digits both a divisor and the quotient need before division switches from schoolbook
+// long division to recursive Burnikel-Ziegler division. This can be tuned for the target machine.
+extern size_t BurnikelZieglerDivideCutoff;
+
 BigNum abs( const BigNum & x );
 BigNum negate( const BigNum & x );
 BigNum multiplyByTwo( const BigNum & x );
 BigNum divideByTwo( const BigNum & x );
+BigNum square( const BigNum & x );
+BigNum multiplyLow( const BigNum & x, const BigNum & y, size_t numDigits );
+BigNum multiplyHigh( const BigNum & x, const BigNum & y, size_t numDigits );
 BigNum leftDigitShift( const BigNum & x, size_t numDigits );
 BigNum rightDigitShift( const BigNum & x, size_t numDigits );
 BigNum mod2b( const BigNum & x, size_t b );
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "BigNumAccumulator.h"
+
+namespace
+{
+
+typedef BigNumAccumulator::word_t word_t;
+
+constexpr auto WordDigitMask = static_cast<word_t>(DigitMask);
+constexpr auto WordDigitBits = static_cast<word_t>(DigitBits);
+
+// Number of terms below b that a lane can hold. This leaves room for the carry coming in from the
+// lane below during normalization, which is at most 2^(word size - DigitBits) < 8 * b.
+constexpr word_t MaxLaneTerms = ~static_cast<word_t>(0) / WordDigitMask - 8;
+constexpr size_t MaxTerms = MaxLaneTerms < static_cast<word_t>(SIZE_MAX) ?
+    static_cast<size_t>(MaxLaneTerms) : SIZE_MAX;
+
+// The carry out of the most significant lane is at most 2^(word size - DigitBits), so it takes at
+// most this many extra digits.
+constexpr size_t CarryDigits = 2;
+
+}
+
+void BigNumAccumulator::add( const BigNum & x )
+{
+    accumulate( lanesFor( x.isNegative() ), x );
+}
+
+void BigNumAccumulator::subtract( const BigNum & x )
+{
+    accumulate( lanesFor( !x.isNegative() ), x );
+}
+
+void BigNumAccumulator::addProduct( const BigNum & x, const BigNum & y )
+{
+    const bool negative = (x.isNegative() != y.isNegative());
+
+    if( std::min( x.numberDigits(), y.numberDigits() ) >= KaratsubaMultiplyCutoff )
+        accumulate( lanesFor( negative ), x * y );
+    else
+        accumulateProduct( lanesFor( negative ), x, y.readDigits(), y.numberDigits() );
+}
+
+void BigNumAccumulator::subtractProduct( const BigNum & x, const BigNum & y )
+{
+    const bool negative = (x.isNegative() == y.isNegative());
+
+    if( std::min( x.numberDigits(), y.numberDigits() ) >= KaratsubaMultiplyCutoff )
+        accumulate( lanesFor( negative ), x * y );
+    else
+        accumulateProduct( lanesFor( negative ), x, y.readDigits(), y.numberDigits() );
+}
+
+void BigNumAccumulator::addProduct( const BigNum & x, digit_t y )
+{
+    accumulateProduct( lanesFor( x.isNegative() ), x, &y, y == 0 ? 0 : 1 );
+}
+
+void BigNumAccumulator::subtractProduct( const BigNum & x, digit_t y )
+{
+    accumulateProduct( lanesFor( !x.isNegative() ), x, &y, y == 0 ? 0 : 1 );
+}
+
+BigNum BigNumAccumulator::value() const
+{
+    BigNum result( toBigNum( m_positive ) );
+    result -= toBigNum( m_negative );
+    return result;
+}
+
+void BigNumAccumulator::zero()
+{
+    m_positive.lanes.clear();
+    m_positive.numTerms = 0;
+    m_negative.lanes.clear();
+    m_negative.numTerms = 0;
+}
+
+// Makes sure there are at least numLanes lanes and that every lane can take numTerms more terms,
+// normalizing the lanes first if it can't.
+void BigNumAccumulator::reserve( Lanes & lanes, size_t numLanes, size_t numTerms )
+{
+    if( lanes.lanes.size() < numLanes )
+        lanes.lanes.resize( numLanes, 0 );
+
+    if( numTerms > MaxTerms - lanes.numTerms )
+        normalize( lanes );
+
+    lanes.numTerms += numTerms;
+}
+
+void BigNumAccumulator::accumulate( Lanes & lanes, const BigNum & x )
+{
+    const size_t numDigits = x.numberDigits();
+    reserve( lanes, numDigits, 1 );
+
+    const digit_t * digits = x.readDigits();
+    word_t * lane = lanes.lanes.data();
+
+    for( size_t iDigit = 0; iDigit < numDigits; ++iDigit )
+        lane[iDigit] += digits[iDigit];
+}
+
+// Adds the magnitude of x * y one row of partial products at a time. Every partial product is split
+// into its low and high digit, which go into neighboring lanes, so no carries are involved at all.
+// Each lane receives at most two terms from each row.
+void BigNumAccumulator::accumulateProduct( Lanes & lanes, const BigNum & x, const digit_t * y,
+    size_t yDigits )
+{
+    const size_t xDigits = x.numberDigits();
+    if( xDigits == 0 || yDigits == 0 )
+        return;
+
+    reserve( lanes, xDigits + yDigits, 2 * std::min( xDigits, yDigits ) );
+
+    const digit_t * xDigit = x.readDigits();
+    word_t * lane = lanes.lanes.data();
+
+    for( size_t iDigit = 0; iDigit < xDigits; ++iDigit )
+    {
+        const auto xi = static_cast<word_t>(xDigit[iDigit]);
+        word_t * row = lane + iDigit;
+
+        for( size_t jDigit = 0; jDigit < yDigits; ++jDigit )
+        {
+            const word_t product = xi * static_cast<word_t>(y[jDigit]);
+            row[jDigit] += product & WordDigitMask;
+            row[jDigit + 1] += product >> WordDigitBits;
+        }
+    }
+}
+
+// Propagates the carries through the lanes, so that each lane holds a single normalized digit.
+void BigNumAccumulator::normalize( Lanes & lanes )
+{
+    word_t carry = 0;
+    for( word_t & lane : lanes.lanes )
+    {
+        const word_t sum = lane + carry;
+        lane = sum & WordDigitMask;
+        carry = sum >> WordDigitBits;
+    }
+
+    while( carry != 0 )
+    {
+        lanes.lanes.push_back( carry & WordDigitMask );
+        carry >>= WordDigitBits;
+    }
+
+    lanes.numTerms = 1;
+}
+
+BigNum BigNumAccumulator::toBigNum( const Lanes & lanes )
+{
+    const size_t numLanes = lanes.lanes.size();
+    BigNum result;
+    digit_t * digits = result.writeDigits( numLanes + CarryDigits );
+
+    word_t carry = 0;
+    for( size_t iLane = 0; iLane < numLanes; ++iLane )
+    {
+        const word_t sum = lanes.lanes[iLane] + carry;
+        digits[iLane] = static_cast<digit_t>(sum & WordDigitMask);
+        carry = sum >> WordDigitBits;
+    }
+
+    for( size_t iDigit = numLanes; iDigit < numLanes + CarryDigits; ++iDigit )
+    {
+        digits[iDigit] = static_cast<digit_t>(carry & WordDigitMask);
+        carry >>= WordDigitBits;
+    }
+
+    result.finishDigits( numLanes + CarryDigits );
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef __BIG_NUM_ACCUMULATOR_H__
+#define __BIG_NUM_ACCUMULATOR_H__
+
+#include <vector>
+
+#include "BigNum.h"
+
+// Sums many BigNums and products of BigNums, e.g., for dot products, multi-exponentiation or CRT
+// recombination, without propagating carries after every term. Each digit position is a lane of a
+// double precision word, and every term is added into the lanes as it is, with each partial
+// product of digits split into a low and a high digit. Lanes only need normalizing once they run
+// out of headroom, which takes about 2^33 terms with 31-bit digits, and when the value is read, so
+// N additions cost about one carry pass instead of N. Negative terms go into a separate set of
+// lanes that is subtracted when the value is read.
+class BigNumAccumulator
+{
+public:
+    typedef BigNum::digit_t digit_t;
+    typedef BigNum::word_t word_t;
+
+    BigNumAccumulator() { }
+
+    void add( const BigNum & x );
+    void subtract( const BigNum & x );
+
+    // Adds or subtracts x * y. Products that would use a subquadratic multiplier are computed as a
+    // BigNum first, and the rest are accumulated one partial product at a time.
+    void addProduct( const BigNum & x, const BigNum & y );
+    void subtractProduct( const BigNum & x, const BigNum & y );
+    void addProduct( const BigNum & x, digit_t y );
+    void subtractProduct( const BigNum & x, digit_t y );
+
+    // Propagates the carries and returns the sum of all terms so far. The accumulator is unchanged.
+    BigNum value() const;
+
+    void zero();
+
+private:
+    struct Lanes
+    {
+        std::vector<word_t> lanes;
+
+        // Upper bound on the number of digit sized terms added into any one lane.
+        size_t numTerms = 0;
+    };
+
+    Lanes & lanesFor( bool negative ) { return negative ? m_negative : m_positive; }
+
+    static void reserve( Lanes & lanes, size_t numLanes, size_t numTerms );
+    static void accumulate( Lanes & lanes, const BigNum & x );
+    static void accumulateProduct( Lanes & lanes, const BigNum & x, const digit_t * y,
+        size_t yDigits );
+    static void normalize( Lanes & lanes );
+    static BigNum toBigNum( const Lanes & lanes );
+
+    Lanes m_positive;
+    Lanes m_negative;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "DigitArena.h"
+
+namespace
+{
+
+thread_local DigitArena * currentArena = nullptr;
+
+// Every allocation is padded to this size so that all allocations stay suitably aligned.
+constexpr size_t AllocationAlignment = alignof( std::max_align_t );
+
+}
+
+DigitArena::DigitArena( size_t blockSize ) :
+    m_blockSize( roundUp( blockSize ) )
+{
+}
+
+void * DigitArena::allocate( size_t numberBytes )
+{
+    numberBytes = roundUp( numberBytes );
+
+    if( m_blocks.empty() || (m_blocks.back().size - m_blocks.back().used) < numberBytes )
+    {
+        // Oversized requests get a block of their own.
+        const size_t size = std::max( m_blockSize, numberBytes );
+        m_blocks.push_back( Block{ std::unique_ptr<unsigned char[]>( new unsigned char[size] ), size, 0 } );
+    }
+
+    Block & block = m_blocks.back();
+    void * memory = block.memory.get() + block.used;
+    block.used += numberBytes;
+    return memory;
+}
+
+void DigitArena::deallocate( void * memory, size_t numberBytes )
+{
+    if( m_blocks.empty() )
+        return;
+
+    // Only the most recent allocation can be handed back. Anything else waits for release().
+    Block & block = m_blocks.back();
+    numberBytes = roundUp( numberBytes );
+
+    if( static_cast<unsigned char *>(memory) + numberBytes == block.memory.get() + block.used )
+        block.used -= numberBytes;
+}
+
+void DigitArena::release()
+{
+    if( m_blocks.empty() )
+        return;
+
+    m_blocks.resize( 1 );
+    m_blocks.front().used = 0;
+}
+
+size_t DigitArena::bytesInUse() const
+{
+    size_t total = 0;
+    for( const auto & block : m_blocks )
+        total += block.used;
+
+    return total;
+}
+
+DigitArena * DigitArena::current()
+{
+    return currentArena;
+}
+
+size_t DigitArena::roundUp( size_t numberBytes )
+{
+    return (numberBytes + AllocationAlignment - 1) / AllocationAlignment * AllocationAlignment;
+}
+
+DigitArenaScope::DigitArenaScope( DigitArena & arena ) :
+    m_previous( currentArena )
+{
+    currentArena = &arena;
+}
+
+DigitArenaScope::~DigitArenaScope()
+{
+    currentArena = m_previous;
+}
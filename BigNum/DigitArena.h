@@ -0,0 +1,66 @@
+#ifndef __DIGIT_ARENA_H__
+#define __DIGIT_ARENA_H__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for BigNum digit storage. While a DigitArenaScope is active on a thread, every
+// BigNum that moves its digits to the heap on that thread takes its memory from the scope's arena
+// instead of the global heap. Freeing digits only gives memory back to the arena when they were
+// the most recent allocation, which covers the short-lived temporaries created inside arithmetic
+// routines. Everything else is reclaimed at once by release().
+//
+// An arena is not thread safe and is meant to be used by one thread at a time. Any BigNum that
+// grew while the arena was active must be destroyed before the arena is released or destroyed.
+class DigitArena
+{
+public:
+    static constexpr size_t DefaultBlockSize = 64 * 1024;
+
+    explicit DigitArena( size_t blockSize = DefaultBlockSize );
+
+    DigitArena( const DigitArena & ) = delete;
+    DigitArena & operator=( const DigitArena & ) = delete;
+
+    void * allocate( size_t numberBytes );
+    void deallocate( void * memory, size_t numberBytes );
+
+    // Reclaims everything allocated from this arena. The first block is kept for reuse.
+    void release();
+
+    size_t bytesInUse() const;
+
+    // Arena used by BigNums on the calling thread, or nullptr if they use the global heap.
+    static DigitArena * current();
+
+private:
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]> memory;
+        size_t size;
+        size_t used;
+    };
+
+    static size_t roundUp( size_t numberBytes );
+
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+};
+
+// Makes the given arena the current arena for the calling thread for the lifetime of the scope.
+// Scopes nest. The previous arena (if any) is restored when the scope ends.
+class DigitArenaScope
+{
+public:
+    explicit DigitArenaScope( DigitArena & arena );
+    ~DigitArenaScope();
+
+    DigitArenaScope( const DigitArenaScope & ) = delete;
+    DigitArenaScope & operator=( const DigitArenaScope & ) = delete;
+
+private:
+    DigitArena * m_previous;
+};
+
+#endif
@@ -0,0 +1,410 @@
+#include "DigitKernels.h"
+
+// The vectorized kernels assume 31-bit digits in 32-bit lanes, and they use 64-bit lane extracts
+// that are only available on x64.
+#if !defined( BIGNUM_64BIT_DIGITS ) && !defined( BIGNUM_NO_SIMD ) && \
+    (defined( _M_X64 ) || defined( __x86_64__ ))
+#define BIGNUM_AVX2_KERNELS 1
+#endif
+
+#ifdef BIGNUM_AVX2_KERNELS
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+
+// MSVC accepts AVX2 intrinsics in any function, regardless of the /arch setting.
+#define BIGNUM_TARGET_AVX2
+#else
+#define BIGNUM_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#endif
+#endif
+
+namespace
+{
+
+typedef BigNum::digit_t digit_t;
+typedef BigNum::word_t word_t;
+
+digit_t addDigitsScalar( digit_t * dst, const digit_t * rhs, size_t count )
+{
+    digit_t carry = 0;
+
+    for( size_t iDigit = 0; iDigit < count; ++iDigit )
+    {
+        dst[iDigit] += rhs[iDigit] + carry;
+        carry = dst[iDigit] >> DigitBits;
+        dst[iDigit] &= DigitMask;
+    }
+
+    return carry;
+}
+
+digit_t subtractDigitsScalar( digit_t * dst, const digit_t * rhs, size_t count )
+{
+    digit_t borrow = 0;
+
+    for( size_t iDigit = 0; iDigit < count; ++iDigit )
+    {
+        // See BorrowShift in Mpn.cpp for how the borrow is extracted.
+        dst[iDigit] = dst[iDigit] - rhs[iDigit] - borrow;
+        borrow = dst[iDigit] >> (DigitBitSize - DigitOne);
+        dst[iDigit] &= DigitMask;
+    }
+
+    return borrow;
+}
+
+digit_t multiplyAddDigitsScalar( digit_t * dst, const digit_t * src, size_t count, digit_t scalar )
+{
+    constexpr auto digitMask = static_cast<word_t>(DigitMask);
+    constexpr auto digitBits = static_cast<word_t>(DigitBits);
+    const auto scalarWord = static_cast<word_t>(scalar);
+    word_t carry = 0;
+
+    for( size_t iDigit = 0; iDigit < count; ++iDigit )
+    {
+        const word_t r = static_cast<word_t>(dst[iDigit]) +
+            scalarWord * static_cast<word_t>(src[iDigit]) + carry;
+
+        dst[iDigit] = static_cast<digit_t>(r & digitMask);
+        carry = r >> digitBits;
+    }
+
+    return static_cast<digit_t>(carry);
+}
+
+digit_t shiftLeftDigitsScalar( digit_t * digits, size_t count, size_t numBits )
+{
+    const size_t carryShift = DigitBits - numBits;
+    digit_t carry = 0;
+
+    for( size_t iDigit = 0; iDigit < count; ++iDigit )
+    {
+        const digit_t nextCarry = digits[iDigit] >> carryShift;
+        digits[iDigit] = ((digits[iDigit] << numBits) | carry) & DigitMask;
+        carry = nextCarry;
+    }
+
+    return carry;
+}
+
+void shiftRightDigitsScalar( digit_t * digits, size_t count, size_t numBits )
+{
+    const digit_t mask = (DigitOne << numBits) - DigitOne;
+    const size_t carryShift = DigitBits - numBits;
+    digit_t carry = 0;
+
+    for( size_t riDigit = count; riDigit > 0; --riDigit )
+    {
+        const digit_t nextCarry = digits[riDigit - 1] & mask;
+        digits[riDigit - 1] = (digits[riDigit - 1] >> numBits) | (carry << carryShift);
+        carry = nextCarry;
+    }
+}
+
+const DigitKernels ScalarKernels =
+{
+    addDigitsScalar,
+    subtractDigitsScalar,
+    multiplyAddDigitsScalar,
+    shiftLeftDigitsScalar,
+    shiftRightDigitsScalar,
+    "scalar"
+};
+
+#ifdef BIGNUM_AVX2_KERNELS
+
+// The add and subtract kernels work on eight digits at a time. Each lane first takes the sum (or
+// difference) of its two digits, which thanks to the spare bit in every digit cannot overflow the
+// lane. The carries that land in each lane's top bit are then moved up one lane and added in,
+// which repeats until no lane carries. A second round is only needed when a lane holds exactly
+// b - 1, so in practice a block takes one or two rounds.
+
+// Moves each 32-bit lane up one position. The top lane is dropped and zero moves into lane 0.
+BIGNUM_TARGET_AVX2 inline __m256i shiftLanesUp32( __m256i x )
+{
+    const __m256i rotate = _mm256_setr_epi32( 7, 0, 1, 2, 3, 4, 5, 6 );
+    return _mm256_blend_epi32( _mm256_permutevar8x32_epi32( x, rotate ),
+        _mm256_setzero_si256(), 0x01 );
+}
+
+BIGNUM_TARGET_AVX2 digit_t addDigitsAvx2( digit_t * dst, const digit_t * rhs, size_t count )
+{
+    const __m256i mask = _mm256_set1_epi32( DigitMask );
+    digit_t carry = 0;
+    size_t iDigit = 0;
+
+    for( ; iDigit + 8 <= count; iDigit += 8 )
+    {
+        const __m256i x = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(dst + iDigit) );
+        const __m256i y = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(rhs + iDigit) );
+        __m256i sum = _mm256_add_epi32( _mm256_add_epi32( x, y ),
+            _mm256_setr_epi32( static_cast<int>(carry), 0, 0, 0, 0, 0, 0, 0 ) );
+        __m256i carries = _mm256_srli_epi32( sum, DigitBits );
+
+        carry = 0;
+        while( !_mm256_testz_si256( carries, carries ) )
+        {
+            carry += static_cast<digit_t>(_mm256_extract_epi32( carries, 7 ));
+            sum = _mm256_add_epi32( _mm256_and_si256( sum, mask ), shiftLanesUp32( carries ) );
+            carries = _mm256_srli_epi32( sum, DigitBits );
+        }
+
+        _mm256_storeu_si256( reinterpret_cast<__m256i *>(dst + iDigit), sum );
+    }
+
+    for( ; iDigit < count; ++iDigit )
+    {
+        dst[iDigit] += rhs[iDigit] + carry;
+        carry = dst[iDigit] >> DigitBits;
+        dst[iDigit] &= DigitMask;
+    }
+
+    return carry;
+}
+
+BIGNUM_TARGET_AVX2 digit_t subtractDigitsAvx2( digit_t * dst, const digit_t * rhs, size_t count )
+{
+    const __m256i mask = _mm256_set1_epi32( DigitMask );
+    digit_t borrow = 0;
+    size_t iDigit = 0;
+
+    for( ; iDigit + 8 <= count; iDigit += 8 )
+    {
+        const __m256i x = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(dst + iDigit) );
+        const __m256i y = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(rhs + iDigit) );
+        __m256i difference = _mm256_sub_epi32( _mm256_sub_epi32( x, y ),
+            _mm256_setr_epi32( static_cast<int>(borrow), 0, 0, 0, 0, 0, 0, 0 ) );
+        __m256i borrows = _mm256_srli_epi32( difference, DigitBitSize - DigitOne );
+
+        borrow = 0;
+        while( !_mm256_testz_si256( borrows, borrows ) )
+        {
+            borrow += static_cast<digit_t>(_mm256_extract_epi32( borrows, 7 ));
+            difference = _mm256_sub_epi32( _mm256_and_si256( difference, mask ),
+                shiftLanesUp32( borrows ) );
+            borrows = _mm256_srli_epi32( difference, DigitBitSize - DigitOne );
+        }
+
+        _mm256_storeu_si256( reinterpret_cast<__m256i *>(dst + iDigit), difference );
+    }
+
+    for( ; iDigit < count; ++iDigit )
+    {
+        dst[iDigit] = dst[iDigit] - rhs[iDigit] - borrow;
+        borrow = dst[iDigit] >> (DigitBitSize - DigitOne);
+        dst[iDigit] &= DigitMask;
+    }
+
+    return borrow;
+}
+
+// Lanes of x moved up one position, with lane 3 of below moving into lane 0. Used to hand the high
+// part of each 64-bit lane to the lane above it.
+BIGNUM_TARGET_AVX2 inline __m256i shiftLanesUp64( __m256i x, __m256i below )
+{
+    return _mm256_blend_epi32( _mm256_permute4x64_epi64( x, _MM_SHUFFLE( 2, 1, 0, 3 ) ),
+        _mm256_permute4x64_epi64( below, _MM_SHUFFLE( 3, 3, 3, 3 ) ), 0x03 );
+}
+
+// Works on eight digits at a time, as two halves of four 64-bit lanes. Each lane computes
+// dst[i] + src[i] * scalar and splits it into a low digit and a high part. The high part of each
+// lane is then added into the lane above, which leaves at most one extra bit per lane to settle
+// the same way as in the add kernel. The carry between blocks stays in a vector register, so the
+// loop never has to move it through a general purpose register.
+BIGNUM_TARGET_AVX2 digit_t multiplyAddDigitsAvx2( digit_t * dst, const digit_t * src, size_t count,
+    digit_t scalar )
+{
+    const __m256i mask = _mm256_set1_epi64x( DigitMask );
+    const __m256i scalarLanes = _mm256_set1_epi64x( scalar );
+    const __m256i evenLanes = _mm256_setr_epi32( 0, 2, 4, 6, 0, 2, 4, 6 );
+    const __m256i zero = _mm256_setzero_si256();
+
+    // Only lane 3 of this is used, as the carry into the next block.
+    __m256i carryOut = zero;
+    size_t iDigit = 0;
+
+    for( ; iDigit + 8 <= count; iDigit += 8 )
+    {
+        const __m256i xLow = _mm256_cvtepu32_epi64(
+            _mm_loadu_si128( reinterpret_cast<const __m128i *>(dst + iDigit) ) );
+        const __m256i xHigh = _mm256_cvtepu32_epi64(
+            _mm_loadu_si128( reinterpret_cast<const __m128i *>(dst + iDigit + 4) ) );
+        const __m256i yLow = _mm256_cvtepu32_epi64(
+            _mm_loadu_si128( reinterpret_cast<const __m128i *>(src + iDigit) ) );
+        const __m256i yHigh = _mm256_cvtepu32_epi64(
+            _mm_loadu_si128( reinterpret_cast<const __m128i *>(src + iDigit + 4) ) );
+
+        const __m256i pLow = _mm256_add_epi64( _mm256_mul_epu32( yLow, scalarLanes ), xLow );
+        const __m256i pHigh = _mm256_add_epi64( _mm256_mul_epu32( yHigh, scalarLanes ), xHigh );
+        const __m256i hLow = _mm256_srli_epi64( pLow, DigitBits );
+        const __m256i hHigh = _mm256_srli_epi64( pHigh, DigitBits );
+
+        __m256i rLow = _mm256_add_epi64( _mm256_and_si256( pLow, mask ),
+            shiftLanesUp64( hLow, carryOut ) );
+        __m256i rHigh = _mm256_add_epi64( _mm256_and_si256( pHigh, mask ),
+            shiftLanesUp64( hHigh, hLow ) );
+        carryOut = hHigh;
+
+        __m256i cLow = _mm256_srli_epi64( rLow, DigitBits );
+        __m256i cHigh = _mm256_srli_epi64( rHigh, DigitBits );
+        while( !_mm256_testz_si256( _mm256_or_si256( cLow, cHigh ), _mm256_or_si256( cLow, cHigh ) ) )
+        {
+            rLow = _mm256_add_epi64( _mm256_and_si256( rLow, mask ), shiftLanesUp64( cLow, zero ) );
+            rHigh = _mm256_add_epi64( _mm256_and_si256( rHigh, mask ), shiftLanesUp64( cHigh, cLow ) );
+            carryOut = _mm256_add_epi64( carryOut, cHigh );
+
+            cLow = _mm256_srli_epi64( rLow, DigitBits );
+            cHigh = _mm256_srli_epi64( rHigh, DigitBits );
+        }
+
+        // Pack the low halves of the 64-bit lanes back into digits.
+        _mm_storeu_si128( reinterpret_cast<__m128i *>(dst + iDigit),
+            _mm256_castsi256_si128( _mm256_permutevar8x32_epi32( rLow, evenLanes ) ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i *>(dst + iDigit + 4),
+            _mm256_castsi256_si128( _mm256_permutevar8x32_epi32( rHigh, evenLanes ) ) );
+    }
+
+    uint64_t carry = static_cast<uint64_t>(_mm256_extract_epi64( carryOut, 3 ));
+
+    for( ; iDigit < count; ++iDigit )
+    {
+        const uint64_t r = static_cast<uint64_t>(dst[iDigit]) +
+            static_cast<uint64_t>(scalar) * static_cast<uint64_t>(src[iDigit]) + carry;
+
+        dst[iDigit] = static_cast<digit_t>(r & DigitMask);
+        carry = r >> DigitBits;
+    }
+
+    return static_cast<digit_t>(carry);
+}
+
+// Shifts have no carry chain. Each output digit depends only on the digit in the same position
+// and its neighbor, so blocks of eight are computed straight from two overlapping loads. The left
+// shift walks down from the top so that the neighbors below are still unshifted when read.
+BIGNUM_TARGET_AVX2 digit_t shiftLeftDigitsAvx2( digit_t * digits, size_t count, size_t numBits )
+{
+    const __m256i mask = _mm256_set1_epi32( DigitMask );
+    const __m128i shift = _mm_cvtsi32_si128( static_cast<int>(numBits) );
+    const __m128i carryShift = _mm_cvtsi32_si128( static_cast<int>(DigitBits - numBits) );
+
+    if( count == 0 )
+        return 0;
+
+    const digit_t carry = digits[count - 1] >> (DigitBits - numBits);
+    size_t iDigit = count;
+
+    for( ; iDigit >= 9; iDigit -= 8 )
+    {
+        digit_t * block = digits + iDigit - 8;
+        const __m256i current = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(block) );
+        const __m256i below = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(block - 1) );
+        const __m256i shifted = _mm256_or_si256(
+            _mm256_and_si256( _mm256_sll_epi32( current, shift ), mask ),
+            _mm256_srl_epi32( below, carryShift ) );
+
+        _mm256_storeu_si256( reinterpret_cast<__m256i *>(block), shifted );
+    }
+
+    for( ; iDigit > 1; --iDigit )
+    {
+        digits[iDigit - 1] = ((digits[iDigit - 1] << numBits) & DigitMask) |
+            (digits[iDigit - 2] >> (DigitBits - numBits));
+    }
+
+    digits[0] = (digits[0] << numBits) & DigitMask;
+    return carry;
+}
+
+BIGNUM_TARGET_AVX2 void shiftRightDigitsAvx2( digit_t * digits, size_t count, size_t numBits )
+{
+    const __m256i mask = _mm256_set1_epi32( DigitMask );
+    const __m128i shift = _mm_cvtsi32_si128( static_cast<int>(numBits) );
+    const __m128i carryShift = _mm_cvtsi32_si128( static_cast<int>(DigitBits - numBits) );
+    size_t iDigit = 0;
+
+    for( ; iDigit + 9 <= count; iDigit += 8 )
+    {
+        digit_t * block = digits + iDigit;
+        const __m256i current = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(block) );
+        const __m256i above = _mm256_loadu_si256( reinterpret_cast<const __m256i *>(block + 1) );
+        const __m256i shifted = _mm256_or_si256( _mm256_srl_epi32( current, shift ),
+            _mm256_and_si256( _mm256_sll_epi32( above, carryShift ), mask ) );
+
+        _mm256_storeu_si256( reinterpret_cast<__m256i *>(block), shifted );
+    }
+
+    for( ; iDigit + 1 < count; ++iDigit )
+    {
+        digits[iDigit] = (digits[iDigit] >> numBits) |
+            ((digits[iDigit + 1] << (DigitBits - numBits)) & DigitMask);
+    }
+
+    if( iDigit < count )
+        digits[iDigit] >>= numBits;
+}
+
+const DigitKernels Avx2Kernels =
+{
+    addDigitsAvx2,
+    subtractDigitsAvx2,
+    multiplyAddDigitsAvx2,
+    shiftLeftDigitsAvx2,
+    shiftRightDigitsAvx2,
+    "avx2"
+};
+
+// Checks that both the processor and the operating system support AVX2, the latter by making
+// sure the OS saves the upper halves of the YMM registers on a context switch.
+bool isAvx2Supported()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid( info, 0 );
+    if( info[0] < 7 )
+        return false;
+
+    constexpr int OsxsaveBit = 1 << 27;
+    constexpr int AvxBit = 1 << 28;
+    __cpuid( info, 1 );
+    if( (info[2] & OsxsaveBit) == 0 || (info[2] & AvxBit) == 0 )
+        return false;
+
+    constexpr unsigned long long XmmYmmState = 0x6;
+    if( (_xgetbv( 0 ) & XmmYmmState) != XmmYmmState )
+        return false;
+
+    constexpr int Avx2Bit = 1 << 5;
+    __cpuidex( info, 7, 0 );
+    return (info[1] & Avx2Bit) != 0;
+#else
+    // GCC and Clang check the OS support as part of this.
+    return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+
+#endif
+
+const DigitKernels & selectDigitKernels()
+{
+#ifdef BIGNUM_AVX2_KERNELS
+    if( isAvx2Supported() )
+        return Avx2Kernels;
+#endif
+
+    return ScalarKernels;
+}
+
+}
+
+const DigitKernels & digitKernels()
+{
+    static const DigitKernels & kernels = selectDigitKernels();
+    return kernels;
+}
+
+const DigitKernels & scalarDigitKernels()
+{
+    return ScalarKernels;
+}
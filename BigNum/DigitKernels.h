@@ -0,0 +1,43 @@
+#ifndef __DIGIT_KERNELS_H__
+#define __DIGIT_KERNELS_H__
+
+#include "BigNum.h"
+
+// Inner loops of the BigNum arithmetic routines, written against raw arrays of normalized digits.
+// Every routine has a portable implementation. On x64 processors with AVX2, some of them also have
+// vectorized implementations, and the best available set is chosen once, the first time
+// digitKernels() is called. That way a single binary runs on any x64 machine and still uses
+// AVX2 wherever it is present.
+struct DigitKernels
+{
+    typedef BigNum::digit_t digit_t;
+
+    // dst[0..count) += rhs[0..count). Returns the carry out of the last digit.
+    digit_t (*addDigits)( digit_t * dst, const digit_t * rhs, size_t count );
+
+    // dst[0..count) -= rhs[0..count). Returns the borrow out of the last digit.
+    digit_t (*subtractDigits)( digit_t * dst, const digit_t * rhs, size_t count );
+
+    // dst[0..count) += src[0..count) * scalar. Returns the carry out of the last digit, which is
+    // always less than b, for the caller to add in at dst[count].
+    digit_t (*multiplyAddDigits)( digit_t * dst, const digit_t * src, size_t count, digit_t scalar );
+
+    // Shifts digits[0..count) left by 0 < numBits < DigitBits. Returns the bits shifted out of the
+    // most significant digit.
+    digit_t (*shiftLeftDigits)( digit_t * digits, size_t count, size_t numBits );
+
+    // Shifts digits[0..count) right by 0 < numBits < DigitBits. Bits shifted out of the least
+    // significant digit are dropped.
+    void (*shiftRightDigits)( digit_t * digits, size_t count, size_t numBits );
+
+    // Name of the instruction set these kernels use, e.g., for logging.
+    const char * name;
+};
+
+// Kernels chosen for the processor this is running on.
+const DigitKernels & digitKernels();
+
+// Portable kernels, which are always available.
+const DigitKernels & scalarDigitKernels();
+
+#endif
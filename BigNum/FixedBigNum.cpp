@@ -0,0 +1,44 @@
+#include "FixedBigNum.h"
+#include "RsaMath.h"
+
+namespace
+{
+
+// The caller computed r and r2 from R = b^l where l is the number of digits in m, so a fixed size
+// can only be used if it has exactly that many digits.
+template <size_t Bits>
+bool fitsFixedSize( const BigNum & m )
+{
+    return m.numberBits() <= Bits && m.numberDigits() == FixedBigNum<Bits>::NumberDigits;
+}
+
+template <size_t Bits>
+BigNum fixedMontgomeryExponentiation( const BigNum & x, const BigNum & e,
+    const BigNum & m, BigNum::digit_t mInv,
+    const BigNum & r, const BigNum & r2 )
+{
+    const FixedBigNum<Bits> result = montgomery_exponentiation( FixedBigNum<Bits>( x ), e,
+        FixedBigNum<Bits>( m ), mInv, FixedBigNum<Bits>( r ), FixedBigNum<Bits>( r2 ) );
+
+    return result.toBigNum();
+}
+
+}
+
+BigNum dispatch_montgomery_exponentiation( const BigNum & x, const BigNum & e,
+    const BigNum & m, BigNum::digit_t mInv,
+    const BigNum & r, const BigNum & r2 )
+{
+    const size_t numberBits = m.numberBits();
+
+    if( numberBits > 3072 && fitsFixedSize<4096>( m ) )
+        return fixedMontgomeryExponentiation<4096>( x, e, m, mInv, r, r2 );
+
+    if( numberBits > 2048 && fitsFixedSize<3072>( m ) )
+        return fixedMontgomeryExponentiation<3072>( x, e, m, mInv, r, r2 );
+
+    if( fitsFixedSize<2048>( m ) )
+        return fixedMontgomeryExponentiation<2048>( x, e, m, mInv, r, r2 );
+
+    return montgomery_exponentiation( x, e, m, mInv, r, r2 );
+}
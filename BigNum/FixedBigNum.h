@@ -0,0 +1,245 @@
+#ifndef __FIXED_BIG_NUM_H__
+#define __FIXED_BIG_NUM_H__
+
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+#include "BigNum.h"
+#include "SlidingWindow.h"
+
+// Nonnegative multi-precision integer with room for a number of bits fixed at compile time. The
+// digits use the same radix as BigNum, but they live in a std::array and every loop runs over a
+// constant number of digits, so there are no capacity checks and the compiler is free to unroll.
+// This is intended for RSA moduli whose size is known up front, e.g., 2048, 3072 or 4096 bits.
+template <size_t Bits>
+class FixedBigNum
+{
+public:
+    typedef BigNum::digit_t digit_t;
+    typedef BigNum::word_t word_t;
+
+    static constexpr size_t NumberDigits = (Bits + DigitBits - 1) / DigitBits;
+
+    // Type able to hold the product of any two values of this type.
+    typedef FixedBigNum<2 * NumberDigits * DigitBits> product_t;
+
+    FixedBigNum() : m_digits() { }
+    explicit FixedBigNum( const BigNum & value );
+
+    BigNum toBigNum() const;
+
+    digit_t getDigit( size_t iDigit ) const { return m_digits[iDigit]; }
+    void setDigit( size_t iDigit, digit_t value ) { m_digits[iDigit] = value; }
+
+    Comparison compare( const FixedBigNum & other ) const;
+
+    // Both return the carry (or borrow) out of the most significant digit.
+    digit_t addEquals( const FixedBigNum & rhs );
+    digit_t subtractEquals( const FixedBigNum & rhs );
+
+private:
+    std::array<digit_t, NumberDigits> m_digits;
+};
+
+template <size_t Bits>
+FixedBigNum<Bits>::FixedBigNum( const BigNum & value ) :
+    m_digits()
+{
+    if( value.isNegative() || value.numberBits() > NumberDigits * DigitBits )
+        throw std::invalid_argument( "Value does not fit in a FixedBigNum of this size." );
+
+    for( size_t iDigit = 0; iDigit < value.numberDigits(); ++iDigit )
+        m_digits[iDigit] = value.getDigit( iDigit );
+}
+
+template <size_t Bits>
+BigNum FixedBigNum<Bits>::toBigNum() const
+{
+    BigNum value( NumberDigits );
+    value.loadDigits( m_digits.data(), NumberDigits );
+    return value;
+}
+
+template <size_t Bits>
+Comparison FixedBigNum<Bits>::compare( const FixedBigNum & other ) const
+{
+    for( size_t riDigit = NumberDigits; riDigit > 0; --riDigit )
+    {
+        if( m_digits[riDigit - 1] > other.m_digits[riDigit - 1] )
+            return Comparison::GreaterThan;
+
+        if( m_digits[riDigit - 1] < other.m_digits[riDigit - 1] )
+            return Comparison::LessThan;
+    }
+
+    return Comparison::Equal;
+}
+
+template <size_t Bits>
+typename FixedBigNum<Bits>::digit_t FixedBigNum<Bits>::addEquals( const FixedBigNum & rhs )
+{
+    digit_t carry = 0;
+
+    for( size_t iDigit = 0; iDigit < NumberDigits; ++iDigit )
+    {
+        m_digits[iDigit] += rhs.m_digits[iDigit] + carry;
+        carry = m_digits[iDigit] >> DigitBits;
+        m_digits[iDigit] &= DigitMask;
+    }
+
+    return carry;
+}
+
+template <size_t Bits>
+typename FixedBigNum<Bits>::digit_t FixedBigNum<Bits>::subtractEquals( const FixedBigNum & rhs )
+{
+    digit_t carry = 0;
+
+    for( size_t iDigit = 0; iDigit < NumberDigits; ++iDigit )
+    {
+        // See BorrowShift in Mpn.cpp for how the borrow is extracted.
+        m_digits[iDigit] = m_digits[iDigit] - rhs.m_digits[iDigit] - carry;
+        carry = m_digits[iDigit] >> (DigitBitSize - DigitOne);
+        m_digits[iDigit] &= DigitMask;
+    }
+
+    return carry;
+}
+
+// Schoolbook multiplication producing the full double length product.
+template <size_t Bits>
+typename FixedBigNum<Bits>::product_t multiply( const FixedBigNum<Bits> & x,
+    const FixedBigNum<Bits> & y )
+{
+    typedef typename FixedBigNum<Bits>::word_t word_t;
+    typedef typename FixedBigNum<Bits>::digit_t digit_t;
+    constexpr size_t numberDigits = FixedBigNum<Bits>::NumberDigits;
+    constexpr auto digitMask = static_cast<word_t>(DigitMask);
+    constexpr auto digitBits = static_cast<word_t>(DigitBits);
+
+    typename FixedBigNum<Bits>::product_t product;
+
+    for( size_t iDigitX = 0; iDigitX < numberDigits; ++iDigitX )
+    {
+        const auto xi = static_cast<word_t>(x.getDigit( iDigitX ));
+        word_t carry = 0;
+
+        for( size_t iDigitY = 0; iDigitY < numberDigits; ++iDigitY )
+        {
+            const size_t iProduct = iDigitX + iDigitY;
+            const word_t r = static_cast<word_t>(product.getDigit( iProduct )) +
+                xi * static_cast<word_t>(y.getDigit( iDigitY )) + carry;
+
+            product.setDigit( iProduct, static_cast<digit_t>(r & digitMask) );
+            carry = r >> digitBits;
+        }
+
+        product.setDigit( iDigitX + numberDigits, static_cast<digit_t>(carry) );
+    }
+
+    return product;
+}
+
+// Based on Algorithm 14.36 in Handbook of Applied Cryptography. The division of A by b in each
+// iteration is folded into the same pass that adds xi * y and ui * m, so A only ever needs one
+// digit more than the modulus.
+template <size_t Bits>
+FixedBigNum<Bits> montgomery_multiply( const FixedBigNum<Bits> & x, const FixedBigNum<Bits> & y,
+    const FixedBigNum<Bits> & m, BigNum::digit_t mInv )
+{
+    typedef typename FixedBigNum<Bits>::word_t word_t;
+    typedef typename FixedBigNum<Bits>::digit_t digit_t;
+    constexpr size_t numberDigits = FixedBigNum<Bits>::NumberDigits;
+    constexpr auto digitMask = static_cast<word_t>(DigitMask);
+    constexpr auto digitBits = static_cast<word_t>(DigitBits);
+
+    std::array<digit_t, numberDigits + 1> a{};
+    const auto y0 = static_cast<word_t>(y.getDigit( 0 ));
+    const auto mInvWord = static_cast<word_t>(mInv);
+
+    for( size_t iDigit = 0; iDigit < numberDigits; ++iDigit )
+    {
+        const auto xi = static_cast<word_t>(x.getDigit( iDigit ));
+        const auto ui = ((((static_cast<word_t>(a[0]) + xi * y0) & digitMask) * mInvWord) & digitMask);
+
+        // The least significant digit of A + xi * y + ui * m is zero by the choice of ui.
+        word_t carry = (static_cast<word_t>(a[0]) + xi * y0 +
+            ui * static_cast<word_t>(m.getDigit( 0 ))) >> digitBits;
+
+        for( size_t jDigit = 1; jDigit < numberDigits; ++jDigit )
+        {
+            const word_t r = static_cast<word_t>(a[jDigit]) +
+                xi * static_cast<word_t>(y.getDigit( jDigit )) +
+                ui * static_cast<word_t>(m.getDigit( jDigit )) + carry;
+
+            a[jDigit - 1] = static_cast<digit_t>(r & digitMask);
+            carry = r >> digitBits;
+        }
+
+        const word_t r = static_cast<word_t>(a[numberDigits]) + carry;
+        a[numberDigits - 1] = static_cast<digit_t>(r & digitMask);
+        a[numberDigits] = static_cast<digit_t>(r >> digitBits);
+    }
+
+    FixedBigNum<Bits> result;
+    for( size_t iDigit = 0; iDigit < numberDigits; ++iDigit )
+        result.setDigit( iDigit, a[iDigit] );
+
+    // A < 2m at this point, so at most one subtraction of m is needed.
+    if( a[numberDigits] != 0 || result.compare( m ) != Comparison::LessThan )
+        result.subtractEquals( m );
+
+    return result;
+}
+
+// Based on HAC algorithm 14.94, with the sliding windows of HAC algorithm 14.85, or the short
+// path in SlidingWindow.h for short exponents. Here R = b^NumberDigits, so r and r2 must be R mod m
+// and R^2 mod m for that R.
+template <size_t Bits>
+FixedBigNum<Bits> montgomery_exponentiation( const FixedBigNum<Bits> & x, const BigNum & e,
+    const FixedBigNum<Bits> & m, BigNum::digit_t mInv,
+    const FixedBigNum<Bits> & r, const FixedBigNum<Bits> & r2 )
+{
+    if( isShortExponent( e ) )
+    {
+        const FixedBigNum<Bits> xBar( montgomery_multiply( x, r2, m, mInv ) );
+        FixedBigNum<Bits> a( r );
+        shortExponentiation( e.getDigit( 0 ),
+            [&]() { a = montgomery_multiply( a, a, m, mInv ); },
+            [&]() { a = montgomery_multiply( a, xBar, m, mInv ); },
+            [&]() { a = xBar; } );
+
+        return montgomery_multiply( a, x, m, mInv );
+    }
+
+    const size_t windowBits = slidingWindowBits( e.numberBits() );
+    std::vector<FixedBigNum<Bits>> powers( size_t( 1 ) << (windowBits - 1) );
+    powers[0] = montgomery_multiply( x, r2, m, mInv );
+    if( powers.size() > 1 )
+    {
+        const FixedBigNum<Bits> xBar2( montgomery_multiply( powers[0], powers[0], m, mInv ) );
+        for( size_t iPower = 1; iPower < powers.size(); ++iPower )
+            powers[iPower] = montgomery_multiply( powers[iPower - 1], xBar2, m, mInv );
+    }
+
+    FixedBigNum<Bits> a( r );
+    slidingWindowExponentiation( e, windowBits,
+        [&]() { a = montgomery_multiply( a, a, m, mInv ); },
+        [&]( size_t iPower ) { a = montgomery_multiply( a, powers[iPower], m, mInv ); },
+        [&]( size_t iPower ) { a = powers[iPower]; } );
+
+    FixedBigNum<Bits> one;
+    one.setDigit( 0, 1 );
+
+    return montgomery_multiply( a, one, m, mInv );
+}
+
+// Runs Montgomery exponentiation with the FixedBigNum instantiation for 2048, 3072 or 4096-bit
+// moduli, chosen from the number of bits in m. The parameters are the same as for the BigNum
+// version of montgomery_exponentiation. Moduli of any other size are handed to that version.
+BigNum dispatch_montgomery_exponentiation( const BigNum & x, const BigNum & e,
+    const BigNum & m, BigNum::digit_t mInv,
+    const BigNum & r, const BigNum & r2 );
+
+#endif
@@ -0,0 +1,267 @@
+#include <stdexcept>
+#include <utility>
+
+#include "Gcd.h"
+
+namespace
+{
+
+typedef BigNum::digit_t digit_t;
+typedef BigNum::word_t word_t;
+
+#ifdef BIGNUM_64BIT_DIGITS
+typedef __int128 signed_word_t;
+#else
+typedef int64_t signed_word_t;
+#endif
+
+// Number of leading bits the single precision steps work on. Knuth shows that every value in the
+// cosequence stays within [-2^h, 2^h] for h bit approximations, and quotients times cosequence
+// values within twice that, so stopping one bit short of two digits keeps them all comfortably
+// inside a signed double precision word.
+constexpr size_t ApproximationBits = 2 * DigitBits - 1;
+
+constexpr auto WordDigitMask = static_cast<word_t>(DigitMask);
+
+// Reads a nonnegative number below 2^ApproximationBits into a word.
+word_t toWord( const BigNum & x )
+{
+    word_t value = 0;
+    for( size_t riDigit = x.numberDigits(); riDigit > 0; --riDigit )
+        value = (value << DigitBits) | x.getDigit( riDigit - 1 );
+
+    return value;
+}
+
+BigNum fromWord( word_t value )
+{
+    constexpr size_t maxDigits = (sizeof( word_t ) * CHAR_BIT + DigitBits - 1) / DigitBits;
+
+    BigNum x;
+    digit_t * digits = x.writeDigits( maxDigits );
+    for( size_t iDigit = 0; iDigit < maxDigits; ++iDigit )
+    {
+        digits[iDigit] = static_cast<digit_t>(value & WordDigitMask);
+        value >>= DigitBits;
+    }
+
+    x.finishDigits( maxDigits );
+    return x;
+}
+
+BigNum fromSignedWord( signed_word_t value )
+{
+    BigNum x( fromWord( static_cast<word_t>(value < 0 ? -value : value) ) );
+    if( value < 0 )
+        x.negate();
+
+    return x;
+}
+
+// Returns bits [shift, shift + ApproximationBits) of a nonnegative x that has no bits at or above
+// shift + ApproximationBits.
+signed_word_t leadingBits( const BigNum & x, size_t shift )
+{
+    const digit_t * digits = x.readDigits();
+    const size_t numDigits = x.numberDigits();
+    const size_t iDigit = shift / DigitBits;
+    const size_t bitShift = shift % DigitBits;
+
+    // ApproximationBits starting partway into a digit span at most three digits.
+    word_t value = 0;
+    if( iDigit < numDigits )
+        value = static_cast<word_t>(digits[iDigit]) >> bitShift;
+    if( iDigit + 1 < numDigits )
+        value |= static_cast<word_t>(digits[iDigit + 1]) << (DigitBits - bitShift);
+    if( iDigit + 2 < numDigits )
+        value |= static_cast<word_t>(digits[iDigit + 2]) << (2 * DigitBits - bitShift);
+
+    return static_cast<signed_word_t>(value);
+}
+
+// Replaces (x, y) with (A x + B y, C x + D y).
+void applyCosequence( BigNum & x, BigNum & y,
+    signed_word_t a, signed_word_t b, signed_word_t c, signed_word_t d )
+{
+    const BigNum bigA( fromSignedWord( a ) );
+    const BigNum bigB( fromSignedWord( b ) );
+    const BigNum bigC( fromSignedWord( c ) );
+    const BigNum bigD( fromSignedWord( d ) );
+
+    BigNum newX( x * bigA );
+    newX += y * bigB;
+    BigNum newY( x * bigC );
+    newY += y * bigD;
+
+    x = newX;
+    y = newY;
+}
+
+// Replaces (x, y) with (y, x - q y).
+void applyQuotient( BigNum & x, BigNum & y, const BigNum & q )
+{
+    BigNum next( x );
+    next -= q * y;
+    x = y;
+    y = next;
+}
+
+// Runs Euclid's algorithm on x >= y >= 0 with Lehmer's speedup, leaving gcd(x, y) in x and zero in
+// y. If cofactors are requested, every step applied to (x, y) is also applied to (u0, u1), so any
+// linear relation that held between x, y and the u's at the start still holds at the end.
+void lehmerGcd( BigNum & x, BigNum & y, BigNum * u0, BigNum * u1 )
+{
+    while( y.numberBits() > ApproximationBits )
+    {
+        // Run Euclid's algorithm on the leading bits of x and y for as long as both ends of the
+        // range the true quotient could lie in give the same quotient (Knuth's Algorithm L).
+        const size_t shift = x.numberBits() - ApproximationBits;
+        signed_word_t xHat = leadingBits( x, shift );
+        signed_word_t yHat = leadingBits( y, shift );
+        signed_word_t a = 1;
+        signed_word_t b = 0;
+        signed_word_t c = 0;
+        signed_word_t d = 1;
+
+        while( yHat + c > 0 && yHat + d > 0 )
+        {
+            const signed_word_t q = (xHat + a) / (yHat + c);
+            if( q != (xHat + b) / (yHat + d) )
+                break;
+
+            signed_word_t t = a - q * c;
+            a = c;
+            c = t;
+            t = b - q * d;
+            b = d;
+            d = t;
+            t = xHat - q * yHat;
+            xHat = yHat;
+            yHat = t;
+        }
+
+        if( b == 0 )
+        {
+            // The leading bits couldn't settle even one quotient, e.g., because x is much larger
+            // than y, so take one step of Euclid's algorithm on the full numbers.
+            const BigNum q( x / y );
+            applyQuotient( x, y, q );
+            if( u0 != nullptr )
+                applyQuotient( *u0, *u1, q );
+        }
+        else
+        {
+            applyCosequence( x, y, a, b, c, d );
+            if( u0 != nullptr )
+                applyCosequence( *u0, *u1, a, b, c, d );
+        }
+    }
+
+    if( y.isZero() )
+        return;
+
+    if( x.numberBits() > ApproximationBits )
+    {
+        const BigNum q( x / y );
+        applyQuotient( x, y, q );
+        if( u0 != nullptr )
+            applyQuotient( *u0, *u1, q );
+    }
+
+    // Both numbers fit in a word now, so finish in machine arithmetic. Only the cofactors, if any,
+    // still need BigNum operations.
+    word_t xWord = toWord( x );
+    word_t yWord = toWord( y );
+
+    while( yWord != 0 )
+    {
+        const word_t q = xWord / yWord;
+        const word_t r = xWord - q * yWord;
+        xWord = yWord;
+        yWord = r;
+
+        if( u0 != nullptr )
+            applyQuotient( *u0, *u1, fromWord( q ) );
+    }
+
+    x = fromWord( xWord );
+    y.zero();
+}
+
+}
+
+BigNum gcd( const BigNum & a, const BigNum & b )
+{
+    BigNum x( abs( a ) );
+    BigNum y( abs( b ) );
+    if( x.compare( y ) == Comparison::LessThan )
+        std::swap( x, y );
+
+    lehmerGcd( x, y, nullptr, nullptr );
+    return x;
+}
+
+BigNum extendedGcd( const BigNum & a, const BigNum & b, BigNum & x, BigNum & y )
+{
+    // Track the coefficient of |a| only, i.e., keep u0 * |a| = x (mod |b|) and likewise for u1.
+    // The coefficient of b follows from the other one at the end.
+    BigNum u( abs( a ) );
+    BigNum v( abs( b ) );
+    BigNum u0;
+    BigNum u1;
+    u0 = 1;
+    u1 = 0;
+
+    if( u.compare( v ) == Comparison::LessThan )
+    {
+        std::swap( u, v );
+        std::swap( u0, u1 );
+    }
+
+    lehmerGcd( u, v, &u0, &u1 );
+
+    x = u0;
+    if( a.isNegative() )
+        x.negate();
+
+    if( b.isZero() )
+    {
+        y = 0;
+    }
+    else
+    {
+        // a * x + b * y = g, and the division is exact.
+        y = u;
+        y -= a * x;
+        y /= b;
+    }
+
+    return u;
+}
+
+BigNum modInverse( const BigNum & a, const BigNum & m )
+{
+    if( m.isZero() || m.isNegative() )
+        throw std::invalid_argument( "Modulus must be positive." );
+
+    BigNum reduced( a );
+    reduced.mod( m );
+
+    // Keep u0 * a = x (mod m) for x = m and u1 * a = y (mod m) for y = a.
+    BigNum x( m );
+    BigNum y( reduced );
+    BigNum u0;
+    BigNum u1;
+    u0 = 0;
+    u1 = 1;
+
+    lehmerGcd( x, y, &u0, &u1 );
+
+    BigNum one;
+    one = 1;
+    if( x.compare( one ) != Comparison::Equal )
+        throw std::invalid_argument( "Value is not invertible modulo the modulus." );
+
+    u0.mod( m );
+    return u0;
+}
@@ -0,0 +1,23 @@
+#ifndef __GCD_H__
+#define __GCD_H__
+
+#include "BigNum.h"
+
+// Greatest common divisors and modular inverses, computed with Lehmer's algorithm (Knuth's
+// Algorithm 4.5.2L, HAC Algorithm 14.57). Each step runs Euclid's algorithm on the leading two
+// digits of both numbers in machine words for as long as that provably agrees with Euclid's
+// algorithm on the full numbers, then applies all of those quotient steps to the full numbers at
+// once. That replaces roughly 2 * DigitBits bits of long division with a handful of multiplications
+// by two digit values, which is what makes 4096-bit inverses cheap.
+
+// Returns gcd(|a|, |b|), which is zero only when both are zero.
+BigNum gcd( const BigNum & a, const BigNum & b );
+
+// Returns g = gcd(|a|, |b|) and sets x and y such that a * x + b * y = g.
+BigNum extendedGcd( const BigNum & a, const BigNum & b, BigNum & x, BigNum & y );
+
+// Returns the inverse of a modulo m in [0, m). Throws std::invalid_argument if m is not positive or
+// a is not coprime to m.
+BigNum modInverse( const BigNum & a, const BigNum & m );
+
+#endif
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "MontgomeryContext.h"
+#include "Mpn.h"
+#include "SlidingWindow.h"
+
+namespace
+{
+
+typedef BigNum::digit_t digit_t;
+
+// Returns at least count digits of scratch space that belong to the calling thread. The buffer only
+// grows, so after the first few calls this is just a size check. Callers take the pointer once and
+// carve it up, since growing the buffer moves it.
+digit_t * threadScratch( size_t count )
+{
+    thread_local std::vector<digit_t> scratch;
+    if( scratch.size() < count )
+        scratch.resize( count );
+
+    return scratch.data();
+}
+
+}
+
+MontgomeryContext::MontgomeryContext( const BigNum & modulus ) :
+    m_modulus( modulus ), m_numDigits( modulus.numberDigits() ), m_nInv( 0 )
+{
+    if( modulus.isNegative() || modulus.isEven() || modulus.numberBits() < 2 )
+        throw std::invalid_argument( "Modulus must be odd and greater than one." );
+
+    m_nInv = (DigitRadix - mpn::binvert_1( modulus.getDigit( 0 ) )) & DigitMask;
+
+    m_r = 1;
+    m_r.leftDigitShift( m_numDigits ).mod( m_modulus );
+
+    m_r2 = m_r * m_r;
+    m_r2.mod( m_modulus );
+}
+
+BigNum MontgomeryContext::toMontgomery( const BigNum & x ) const
+{
+    return multiply( x, m_r2 );
+}
+
+BigNum MontgomeryContext::fromMontgomery( const BigNum & x ) const
+{
+    const size_t n = m_numDigits;
+    digit_t * scratch = threadScratch( 3 * n + 1 );
+
+    BigNum result;
+    digit_t * resultDigits = result.writeDigits( n );
+    mpn::copy_padded( scratch, x, n );
+    reduceDigits( resultDigits, scratch, scratch + n );
+    result.finishDigits( n );
+    return result;
+}
+
+BigNum MontgomeryContext::multiply( const BigNum & x, const BigNum & y ) const
+{
+    const size_t n = m_numDigits;
+    digit_t * scratch = threadScratch( 4 * n + 1 );
+    digit_t * xDigits = scratch;
+    digit_t * yDigits = scratch + n;
+
+    mpn::copy_padded( xDigits, x, n );
+    mpn::copy_padded( yDigits, y, n );
+
+    BigNum result;
+    multiplyDigits( result.writeDigits( n ), xDigits, yDigits, scratch + 2 * n );
+    result.finishDigits( n );
+    return result;
+}
+
+BigNum MontgomeryContext::square( const BigNum & x ) const
+{
+    const size_t n = m_numDigits;
+    digit_t * scratch = threadScratch( 3 * n + 1 );
+
+    mpn::copy_padded( scratch, x, n );
+
+    BigNum result;
+    multiplyDigits( result.writeDigits( n ), scratch, scratch, scratch + n );
+    result.finishDigits( n );
+    return result;
+}
+
+// Based on HAC algorithm 14.94 with the sliding windows of HAC algorithm 14.85, like
+// montgomery_exponentiation, but with every intermediate value kept in the thread's scratch buffer.
+BigNum MontgomeryContext::exp( const BigNum & x, const BigNum & e ) const
+{
+    if( isShortExponent( e ) )
+        return expShort( x, e.getDigit( 0 ) );
+
+    const size_t n = m_numDigits;
+    const size_t windowBits = slidingWindowBits( e.numberBits() );
+    const size_t numPowers = size_t( 1 ) << (windowBits - 1);
+
+    digit_t * scratch = threadScratch( (numPowers + 3) * n + 1 );
+    digit_t * t = scratch;
+    digit_t * a = scratch + 2 * n + 1;
+    digit_t * powers = a + n;
+
+    // Odd powers of xBar = x * R mod n, i.e., xBar, xBar^3, xBar^5, ... in Montgomery form, with
+    // xBar computed as Mont(x, R^2). a holds xBar^2 while the table is built.
+    mpn::copy_padded( a, m_r2, n );
+    mpn::copy_padded( powers, x, n );
+    multiplyDigits( powers, powers, a, t );
+    if( numPowers > 1 )
+    {
+        multiplyDigits( a, powers, powers, t );
+        for( size_t iPower = 1; iPower < numPowers; ++iPower )
+            multiplyDigits( powers + iPower * n, powers + (iPower - 1) * n, a, t );
+    }
+
+    // a starts out as 1 in Montgomery form.
+    mpn::copy_padded( a, m_r, n );
+    slidingWindowExponentiation( e, windowBits,
+        [&]() { multiplyDigits( a, a, a, t ); },
+        [&]( size_t iPower ) { multiplyDigits( a, a, powers + iPower * n, t ); },
+        [&]( size_t iPower ) { std::copy( powers + iPower * n, powers + (iPower + 1) * n, a ); } );
+
+    BigNum result;
+    reduceDigits( result.writeDigits( n ), a, t );
+    result.finishDigits( n );
+    return result;
+}
+
+BigNum MontgomeryContext::expShort( const BigNum & x, digit_t e ) const
+{
+    // x^0 = 1, i.e., R mod n taken out of Montgomery form. shortExponentiation needs e >= 1.
+    if( e == 0 )
+        return fromMontgomery( m_r );
+
+    const size_t n = m_numDigits;
+    digit_t * scratch = threadScratch( 5 * n + 1 );
+    digit_t * t = scratch;
+    digit_t * a = scratch + 2 * n + 1;
+    digit_t * xBar = a + n;
+    digit_t * xDigits = xBar + n;
+
+    mpn::copy_padded( xDigits, x, n );
+    mpn::copy_padded( a, m_r2, n );
+    multiplyDigits( xBar, xDigits, a, t );
+
+    mpn::copy_padded( a, m_r, n );
+    shortExponentiation( e,
+        [&]() { multiplyDigits( a, a, a, t ); },
+        [&]() { multiplyDigits( a, a, xBar, t ); },
+        [&]() { std::copy( xBar, xBar + n, a ); } );
+
+    BigNum result;
+    multiplyDigits( result.writeDigits( n ), a, xDigits, t );
+    result.finishDigits( n );
+    return result;
+}
+
+BigNum MontgomeryContext::expConstantTime( const BigNum & x, const BigNum & e ) const
+{
+    const size_t n = m_numDigits;
+    const size_t eBits = std::max( e.numberBits(), m_modulus.numberBits() );
+    const size_t eDigits = (eBits + DigitBits - 1) / DigitBits;
+
+    digit_t * scratch = threadScratch( 3 * n + eDigits + mpn::sec_powm_itch( n, eBits ) );
+    digit_t * xDigits = scratch;
+    digit_t * r = xDigits + n;
+    digit_t * r2 = r + n;
+    digit_t * eDigitsPadded = r2 + n;
+
+    mpn::copy_padded( xDigits, x, n );
+    mpn::copy_padded( r, m_r, n );
+    mpn::copy_padded( r2, m_r2, n );
+    mpn::copy_padded( eDigitsPadded, e, eDigits );
+
+    BigNum result;
+    mpn::sec_powm( result.writeDigits( n ), xDigits, eDigitsPadded, eBits,
+        m_modulus.readDigits(), n, m_nInv, r, r2, eDigitsPadded + eDigits );
+    result.finishDigits( n );
+    return result;
+}
+
+// dst[0..n) = x * y * R^-1 mod n for n digit spans x and y, using t[0..2n] as scratch. dst may be x
+// or y.
+void MontgomeryContext::multiplyDigits( digit_t * dst, const digit_t * x, const digit_t * y,
+    digit_t * t ) const
+{
+    const size_t n = m_numDigits;
+    mpn::mulredc_1( dst, x, n, y, n, m_modulus.readDigits(), n, m_nInv, t );
+}
+
+// dst[0..n) = x * R^-1 mod n for an n digit span x, using t[0..2n] as scratch.
+void MontgomeryContext::reduceDigits( digit_t * dst, const digit_t * x, digit_t * t ) const
+{
+    const size_t n = m_numDigits;
+    std::copy( x, x + n, t );
+    std::fill( t + n, t + 2 * n + 1, 0 );
+    mpn::redc_1( dst, t, m_modulus.readDigits(), n, m_nInv );
+}
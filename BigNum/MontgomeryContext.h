@@ -0,0 +1,70 @@
+#ifndef __MONTGOMERY_CONTEXT_H__
+#define __MONTGOMERY_CONTEXT_H__
+
+#include "BigNum.h"
+
+// Everything Montgomery arithmetic modulo a fixed odd modulus n needs, computed once when the
+// context is built: n' = -n^-1 mod b by Hensel lifting, and R mod n and R^2 mod n for R = b^k,
+// where n has k digits. A context never changes after construction, so a single one can be shared
+// by any number of threads.
+//
+// The arithmetic runs on digit spans in a scratch buffer that belongs to the calling thread and
+// only ever grows, so once a thread has used a modulus of a given size, multiply, square and exp
+// don't allocate, apart from a result that doesn't fit in a BigNum's inline digits.
+class MontgomeryContext
+{
+public:
+    typedef BigNum::digit_t digit_t;
+
+    // Throws std::invalid_argument unless the modulus is odd and greater than one.
+    explicit MontgomeryContext( const BigNum & modulus );
+
+    const BigNum & modulus() const { return m_modulus; }
+    digit_t nInv() const { return m_nInv; }
+    const BigNum & r() const { return m_r; }
+    const BigNum & r2() const { return m_r2; }
+
+    // Returns x * R mod n and x * R^-1 mod n respectively, for 0 <= x < n.
+    BigNum toMontgomery( const BigNum & x ) const;
+    BigNum fromMontgomery( const BigNum & x ) const;
+
+    // Return x * y * R^-1 mod n and x^2 * R^-1 mod n, for 0 <= x, y < n.
+    BigNum multiply( const BigNum & x, const BigNum & y ) const;
+    BigNum square( const BigNum & x ) const;
+
+    // Returns x^e mod n for 0 <= x < n and e >= 0. Neither x nor the result is in Montgomery form.
+    BigNum exp( const BigNum & x, const BigNum & e ) const;
+
+    // exp for an exponent 0 <= e < b, which exp itself also uses for such exponents. For e >= 1
+    // this takes one conversion into Montgomery form, a squaring per bit of e - 1 and a
+    // multiplication per set bit, with the conversion out of Montgomery form folded into the last
+    // multiplication.
+    BigNum expShort( const BigNum & x, digit_t e ) const;
+
+    // Returns x^(2^K + 1) mod n for 0 <= x < n, e.g., expFermat<16> for e = 65537, which takes K
+    // squarings and two multiplications.
+    template <size_t K>
+    BigNum expFermat( const BigNum & x ) const
+    {
+        static_assert( K > 0 && K < DigitBits, "2^K + 1 must fit in a digit." );
+        return expShort( x, (digit_t( 1 ) << K) + 1 );
+    }
+
+    // The same as exp, but for secret exponents such as an RSA private exponent: the operations and
+    // memory accesses only depend on the size of the modulus and on the number of bits in e when it
+    // is longer than the modulus. This uses fixed windows with every table lookup scanning the whole
+    // table, and Montgomery products without a data dependent final subtraction.
+    BigNum expConstantTime( const BigNum & x, const BigNum & e ) const;
+
+private:
+    void multiplyDigits( digit_t * dst, const digit_t * x, const digit_t * y, digit_t * t ) const;
+    void reduceDigits( digit_t * dst, const digit_t * x, digit_t * t ) const;
+
+    BigNum m_modulus;
+    size_t m_numDigits;
+    digit_t m_nInv;
+    BigNum m_r;
+    BigNum m_r2;
+};
+
+#endif
@@ -0,0 +1,524 @@
+#include <algorithm>
+
+#include "DigitKernels.h"
+#include "Mpn.h"
+
+namespace
+{
+
+typedef BigNum::digit_t digit_t;
+typedef BigNum::word_t word_t;
+
+constexpr auto WordDigitMask = static_cast<word_t>(DigitMask);
+constexpr auto WordDigitBits = static_cast<word_t>(DigitBits);
+
+// A digit only uses DigitBits of its bits, so when a digit difference borrows, the borrow propagates
+// into the most significant bit of the digit, where it can be read off directly. This optimization
+// from BigNum Math only works on machines that perform 2's complement arithmetic, which is valid
+// for x86/x64 and RISC-V.
+constexpr digit_t BorrowShift = DigitBitSize - DigitOne;
+
+// Adds xi * y and ui * m to t in the same pass for every digit xi of x, where ui makes the sum
+// divisible by b, and stores every digit one place down, so the division by b costs nothing. t
+// stays below 2m between iterations, so the shifted sum always fits back into its n + 1 digits.
+// The loops depend only on the lengths, never on the digits.
+//
+// With the spare bit in each digit, t[j] + xi * y[j] + ui * m[j] plus the carry stays below
+// 2^(2 * DigitBits + 1), so the whole column fits in a double precision word.
+void ciosMultiply( const digit_t * x, size_t xn, const digit_t * y, size_t yn,
+    const digit_t * m, size_t n, digit_t mInv, digit_t * t )
+{
+    std::fill( t, t + n + 1, 0 );
+
+    const auto y0 = static_cast<word_t>(yn == 0 ? 0 : y[0]);
+    const auto mInvWord = static_cast<word_t>(mInv);
+
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const auto xi = static_cast<word_t>(iDigit < xn ? x[iDigit] : 0);
+
+        // Column 0 is zero once ui * m0 is added, so only its carry is kept.
+        word_t column = static_cast<word_t>(t[0]) + xi * y0;
+        const word_t ui = ((column & WordDigitMask) * mInvWord) & WordDigitMask;
+        column += ui * static_cast<word_t>(m[0]);
+        word_t carry = column >> WordDigitBits;
+
+        size_t jDigit = 1;
+        for( ; jDigit < yn; ++jDigit )
+        {
+            column = static_cast<word_t>(t[jDigit]) + xi * static_cast<word_t>(y[jDigit]) +
+                ui * static_cast<word_t>(m[jDigit]) + carry;
+            t[jDigit - 1] = static_cast<digit_t>(column & WordDigitMask);
+            carry = column >> WordDigitBits;
+        }
+
+        for( ; jDigit < n; ++jDigit )
+        {
+            column = static_cast<word_t>(t[jDigit]) + ui * static_cast<word_t>(m[jDigit]) + carry;
+            t[jDigit - 1] = static_cast<digit_t>(column & WordDigitMask);
+            carry = column >> WordDigitBits;
+        }
+
+        column = static_cast<word_t>(t[n]) + carry;
+        t[n - 1] = static_cast<digit_t>(column & WordDigitMask);
+        t[n] = static_cast<digit_t>(column >> WordDigitBits);
+    }
+}
+
+// Returns all ones if d is nonzero and zero otherwise, without branching on d.
+digit_t nonzeroMask( digit_t d )
+{
+    return digit_t( 0 ) - ((d | (digit_t( 0 ) - d)) >> (DigitBitSize - 1));
+}
+
+// Number of exponent bits per window for sec_powm. Each window costs one multiplication plus a scan
+// of the whole table of 2^k entries, so going from k to k + 1 bits pays off once the exponent has
+// more than 2^k * k * (k + 1) bits. The cap keeps the scans from dominating.
+constexpr size_t MaxSecWindowBits = 6;
+
+size_t secWindowBits( size_t eBits )
+{
+    size_t windowBits = 1;
+    while( windowBits < MaxSecWindowBits &&
+        eBits > (size_t( 1 ) << windowBits) * windowBits * (windowBits + 1) )
+    {
+        ++windowBits;
+    }
+
+    return windowBits;
+}
+
+// Returns bits [iBit, iBit + k) of the eDigits digits of e for k <= DigitBits. Only the positions
+// decide which digits are read.
+digit_t exponentWindow( const digit_t * e, size_t eDigits, size_t iBit, size_t k )
+{
+    if( k == 0 )
+        return 0;
+
+    const size_t iDigit = iBit / DigitBits;
+    const size_t shift = iBit % DigitBits;
+
+    word_t bits = static_cast<word_t>(e[iDigit]) >> shift;
+    if( shift + k > DigitBits && iDigit + 1 < eDigits )
+        bits |= static_cast<word_t>(e[iDigit + 1]) << (DigitBits - shift);
+
+    return static_cast<digit_t>(bits) & ((DigitOne << k) - DigitOne);
+}
+
+}
+
+namespace mpn
+{
+
+digit_t add_n( digit_t * dst, const digit_t * a, const digit_t * b, size_t n )
+{
+    if( dst == a )
+        return digitKernels().addDigits( dst, b, n );
+
+    if( dst == b )
+        return digitKernels().addDigits( dst, a, n );
+
+    digit_t carry = 0;
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const digit_t sum = a[iDigit] + b[iDigit] + carry;
+        dst[iDigit] = sum & DigitMask;
+        carry = sum >> DigitBits;
+    }
+
+    return carry;
+}
+
+digit_t sub_n( digit_t * dst, const digit_t * a, const digit_t * b, size_t n )
+{
+    if( dst == a )
+        return digitKernels().subtractDigits( dst, b, n );
+
+    digit_t borrow = 0;
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const digit_t difference = a[iDigit] - b[iDigit] - borrow;
+        dst[iDigit] = difference & DigitMask;
+        borrow = difference >> BorrowShift;
+    }
+
+    return borrow;
+}
+
+digit_t add_1( digit_t * dst, const digit_t * a, size_t n, digit_t b )
+{
+    size_t iDigit;
+    for( iDigit = 0; b != 0 && iDigit < n; ++iDigit )
+    {
+        const digit_t sum = a[iDigit] + b;
+        dst[iDigit] = sum & DigitMask;
+        b = sum >> DigitBits;
+    }
+
+    if( dst != a )
+        std::copy( a + iDigit, a + n, dst + iDigit );
+
+    return b;
+}
+
+digit_t sub_1( digit_t * dst, const digit_t * a, size_t n, digit_t b )
+{
+    size_t iDigit;
+    for( iDigit = 0; b != 0 && iDigit < n; ++iDigit )
+    {
+        const digit_t difference = a[iDigit] - b;
+        dst[iDigit] = difference & DigitMask;
+        b = difference >> BorrowShift;
+    }
+
+    if( dst != a )
+        std::copy( a + iDigit, a + n, dst + iDigit );
+
+    return b;
+}
+
+digit_t add( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn )
+{
+    const digit_t carry = add_n( dst, a, b, bn );
+    return add_1( dst + bn, a + bn, an - bn, carry );
+}
+
+digit_t sub( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn )
+{
+    const digit_t borrow = sub_n( dst, a, b, bn );
+    return sub_1( dst + bn, a + bn, an - bn, borrow );
+}
+
+digit_t mul_1( digit_t * dst, const digit_t * a, size_t n, digit_t b )
+{
+    const auto bWord = static_cast<word_t>(b);
+    word_t carry = 0;
+
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const word_t r = static_cast<word_t>(a[iDigit]) * bWord + carry;
+        dst[iDigit] = static_cast<digit_t>(r & WordDigitMask);
+        carry = r >> WordDigitBits;
+    }
+
+    return static_cast<digit_t>(carry);
+}
+
+digit_t addmul_1( digit_t * dst, const digit_t * a, size_t n, digit_t b )
+{
+    return digitKernels().multiplyAddDigits( dst, a, n, b );
+}
+
+digit_t submul_1( digit_t * dst, const digit_t * a, size_t n, digit_t b )
+{
+    const auto bWord = static_cast<word_t>(b);
+    word_t borrow = 0;
+
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const word_t p = bWord * static_cast<word_t>(a[iDigit]) + borrow;
+        const digit_t difference = dst[iDigit] - static_cast<digit_t>(p & WordDigitMask);
+        dst[iDigit] = difference & DigitMask;
+        borrow = (p >> WordDigitBits) + static_cast<word_t>(difference >> BorrowShift);
+    }
+
+    return static_cast<digit_t>(borrow);
+}
+
+void mul_basecase( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn )
+{
+    mul_columns( dst, a, an, b, bn, 0, an + bn );
+}
+
+// Based on the Comba multiplier in section 5.2.1 of BigNum Math. All partial products that land in
+// a column are summed in a three digit accumulator before the column's digit is written, so each
+// digit of dst is stored exactly once and never read.
+//
+// The accumulator is kept as two double precision words. Each product is split at the digit
+// boundary, its low half is added into low and its high half into high. Both halves are at most one
+// digit wide, so neither word can overflow for any realistic number of digits, and no carry has to
+// be tested per product. Together low and high hold the digits c0, c1 and c2 of the column sum.
+void mul_columns( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn,
+    size_t firstColumn, size_t endColumn )
+{
+    word_t low = 0;
+    word_t high = 0;
+
+    for( size_t iColumn = firstColumn; iColumn < endColumn; ++iColumn )
+    {
+        // The digits of a that meet a digit of b in this column.
+        const size_t iFirst = iColumn < bn ? 0 : iColumn - bn + 1;
+        const size_t iLast = std::min( iColumn + 1, an );
+
+        for( size_t iDigit = iFirst; iDigit < iLast; ++iDigit )
+        {
+            const word_t product = static_cast<word_t>(a[iDigit]) *
+                static_cast<word_t>(b[iColumn - iDigit]);
+
+            low += product & WordDigitMask;
+            high += product >> WordDigitBits;
+        }
+
+        // Store c0 and shift the accumulator down by one digit.
+        dst[iColumn] = static_cast<digit_t>(low & WordDigitMask);
+        low = (low >> WordDigitBits) + high;
+        high = 0;
+    }
+}
+
+// Based on Algorithm 14.16 in Handbook of Applied Cryptography, as adapted by BigNum Math. In the
+// square of x, every cross product xi * xj with i != j shows up twice, so each is computed once and
+// doubled, and only the products xi * xi on the diagonal stand alone. That takes about half the
+// digit multiplications of a general multiply.
+void sqr_basecase( digit_t * dst, const digit_t * a, size_t n )
+{
+    std::fill( dst, dst + 2 * n, 0 );
+
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const auto ai = static_cast<word_t>(a[iDigit]);
+
+        // Diagonal term.
+        word_t r = static_cast<word_t>(dst[2 * iDigit]) + ai * ai;
+        dst[2 * iDigit] = static_cast<digit_t>(r & WordDigitMask);
+        word_t carry = r >> WordDigitBits;
+
+        // Doubled cross terms. With the spare bit in each digit, 2 * ai * aj plus a digit and the
+        // carry still fits in a double precision word.
+        for( size_t jDigit = iDigit + 1; jDigit < n; ++jDigit )
+        {
+            const word_t product = ai * static_cast<word_t>(a[jDigit]);
+            r = static_cast<word_t>(dst[iDigit + jDigit]) + product + product + carry;
+            dst[iDigit + jDigit] = static_cast<digit_t>(r & WordDigitMask);
+            carry = r >> WordDigitBits;
+        }
+
+        // The partial sum never exceeds the full square, so the carry dies out within dst.
+        for( size_t kDigit = iDigit + n; carry != 0; ++kDigit )
+        {
+            r = static_cast<word_t>(dst[kDigit]) + carry;
+            dst[kDigit] = static_cast<digit_t>(r & WordDigitMask);
+            carry = r >> WordDigitBits;
+        }
+    }
+}
+
+digit_t lshift( digit_t * dst, const digit_t * a, size_t n, size_t numBits )
+{
+    if( dst == a )
+        return digitKernels().shiftLeftDigits( dst, n, numBits );
+
+    if( n == 0 )
+        return 0;
+
+    // Work down from the most significant digit so that dst may start above a.
+    const size_t carryShift = DigitBits - numBits;
+    const digit_t carry = a[n - 1] >> carryShift;
+
+    for( size_t iDigit = n - 1; iDigit > 0; --iDigit )
+        dst[iDigit] = ((a[iDigit] << numBits) | (a[iDigit - 1] >> carryShift)) & DigitMask;
+
+    dst[0] = (a[0] << numBits) & DigitMask;
+    return carry;
+}
+
+digit_t rshift( digit_t * dst, const digit_t * a, size_t n, size_t numBits )
+{
+    if( n == 0 )
+        return 0;
+
+    const digit_t shiftedOut = a[0] & ((DigitOne << numBits) - DigitOne);
+
+    if( dst == a )
+    {
+        digitKernels().shiftRightDigits( dst, n, numBits );
+        return shiftedOut;
+    }
+
+    // Work up from the least significant digit so that dst may start below a.
+    const size_t carryShift = DigitBits - numBits;
+    for( size_t iDigit = 0; iDigit + 1 < n; ++iDigit )
+        dst[iDigit] = ((a[iDigit] >> numBits) | (a[iDigit + 1] << carryShift)) & DigitMask;
+
+    dst[n - 1] = a[n - 1] >> numBits;
+    return shiftedOut;
+}
+
+Comparison cmp( const digit_t * a, const digit_t * b, size_t n )
+{
+    for( size_t riDigit = n; riDigit > 0; --riDigit )
+    {
+        if( a[riDigit - 1] != b[riDigit - 1] )
+            return a[riDigit - 1] > b[riDigit - 1] ? Comparison::GreaterThan : Comparison::LessThan;
+    }
+
+    return Comparison::Equal;
+}
+
+void copy_padded( digit_t * dst, const BigNum & x, size_t n )
+{
+    const digit_t * digits = x.readDigits();
+    const size_t numDigits = x.numberDigits();
+    std::copy( digits, digits + numDigits, dst );
+    std::fill( dst + numDigits, dst + n, 0 );
+}
+
+// Newton's iteration for 1/d in the 2-adic numbers, i.e., Hensel lifting. Each step doubles the
+// number of correct low bits, starting from the three bits that d * d = 1 (mod 8) provides.
+digit_t binvert_1( digit_t d )
+{
+    digit_t inverse = d;
+    for( size_t correctBits = 3; correctBits < DigitBits; correctBits *= 2 )
+        inverse *= 2 - d * inverse;
+
+    return inverse & DigitMask;
+}
+
+// Based on Algorithm 14.32 in Handbook of Applied Cryptography.
+void redc_1( digit_t * dst, digit_t * t, const digit_t * m, size_t n, digit_t mInv )
+{
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        // Choose ui so that adding ui * m * b^i clears digit i.
+        const auto ui = static_cast<digit_t>(
+            (static_cast<word_t>(t[iDigit]) * static_cast<word_t>(mInv)) & WordDigitMask );
+
+        const digit_t carry = addmul_1( t + iDigit, m, n, ui );
+        add_1( t + iDigit + n, t + iDigit + n, n + 1 - iDigit, carry );
+    }
+
+    // The result in t[n..2n] is less than 2m, so at most one subtraction of m is needed. Any
+    // borrow out of the low n digits is absorbed by t[2n].
+    digit_t * result = t + n;
+    if( result[n] != 0 || cmp( result, m, n ) != Comparison::LessThan )
+        sub_n( result, result, m, n );
+
+    if( dst != result )
+        std::copy( result, result + n, dst );
+}
+
+
+// Based on Koc, Acar and Kaliski, "Analyzing and Comparing Montgomery Multiplication Algorithms",
+// and Algorithm 14.36 in Handbook of Applied Cryptography.
+void mulredc_1( digit_t * dst, const digit_t * x, size_t xn, const digit_t * y, size_t yn,
+    const digit_t * m, size_t n, digit_t mInv, digit_t * t )
+{
+    ciosMultiply( x, xn, y, yn, m, n, mInv, t );
+
+    // t < 2m, so at most one subtraction of m is needed. Any borrow out of the low n digits is
+    // absorbed by t[n].
+    if( t[n] != 0 || cmp( t, m, n ) != Comparison::LessThan )
+        sub_n( t, t, m, n );
+
+    if( dst != t )
+        std::copy( t, t + n, dst );
+}
+
+digit_t cnd_add_n( digit_t cnd, digit_t * dst, const digit_t * a, const digit_t * b, size_t n )
+{
+    const digit_t mask = nonzeroMask( cnd );
+    digit_t carry = 0;
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const digit_t sum = a[iDigit] + (b[iDigit] & mask) + carry;
+        dst[iDigit] = sum & DigitMask;
+        carry = sum >> DigitBits;
+    }
+
+    return carry;
+}
+
+digit_t cnd_sub_n( digit_t cnd, digit_t * dst, const digit_t * a, const digit_t * b, size_t n )
+{
+    const digit_t mask = nonzeroMask( cnd );
+    digit_t borrow = 0;
+    for( size_t iDigit = 0; iDigit < n; ++iDigit )
+    {
+        const digit_t difference = a[iDigit] - (b[iDigit] & mask) - borrow;
+        dst[iDigit] = difference & DigitMask;
+        borrow = difference >> BorrowShift;
+    }
+
+    return borrow;
+}
+
+void sec_tabselect( digit_t * dst, const digit_t * table, size_t n, size_t numEntries,
+    size_t iEntry )
+{
+    std::fill( dst, dst + n, 0 );
+
+    for( size_t jEntry = 0; jEntry < numEntries; ++jEntry )
+    {
+        const digit_t mask = ~nonzeroMask( static_cast<digit_t>(jEntry ^ iEntry) );
+        const digit_t * entry = table + jEntry * n;
+        for( size_t iDigit = 0; iDigit < n; ++iDigit )
+            dst[iDigit] |= entry[iDigit] & mask;
+    }
+}
+
+// The same pass as mulredc_1, but the final subtraction is always carried out, and undone with a
+// masked addition if it went below zero.
+void sec_mulredc_1( digit_t * dst, const digit_t * x, const digit_t * y,
+    const digit_t * m, size_t n, digit_t mInv, digit_t * t )
+{
+    ciosMultiply( x, n, y, n, m, n, mInv, t );
+
+    // t < 2m, so t[n] is at most one, and t - m is negative exactly when the subtraction borrows
+    // out of the low n digits and t[n] is zero.
+    const digit_t borrow = cnd_sub_n( 1, t, t, m, n );
+    cnd_add_n( borrow & (t[n] ^ 1), t, t, m, n );
+
+    if( dst != t )
+        std::copy( t, t + n, dst );
+}
+
+size_t sec_powm_itch( size_t n, size_t eBits )
+{
+    return ((size_t( 1 ) << secWindowBits( eBits )) + 3) * n + 1;
+}
+
+// Left-to-right fixed-window exponentiation (HAC Algorithm 14.82) in Montgomery form. Every window
+// costs the same squarings and one multiplication, even by table[0] = R mod m for a window of
+// zeros, and every table lookup reads the whole table, so neither the sequence of operations nor
+// the memory accessed depends on e.
+void sec_powm( digit_t * dst, const digit_t * x, const digit_t * e, size_t eBits,
+    const digit_t * m, size_t n, digit_t mInv, const digit_t * r, const digit_t * r2,
+    digit_t * scratch )
+{
+    const size_t windowBits = secWindowBits( eBits );
+    const size_t numEntries = size_t( 1 ) << windowBits;
+    const size_t eDigits = (eBits + DigitBits - 1) / DigitBits;
+
+    digit_t * table = scratch;
+    digit_t * a = table + numEntries * n;
+    digit_t * entry = a + n;
+    digit_t * t = entry + n;
+
+    // table[i] = xBar^i for xBar = x * R mod m, so table[0] is 1 in Montgomery form.
+    std::copy( r, r + n, table );
+    sec_mulredc_1( table + n, x, r2, m, n, mInv, t );
+    for( size_t iEntry = 2; iEntry < numEntries; ++iEntry )
+        sec_mulredc_1( table + iEntry * n, table + (iEntry - 1) * n, table + n, m, n, mInv, t );
+
+    // The first window takes whatever is left over at the top of e, so the rest are all full.
+    const size_t firstBits = eBits == 0 ? 0 : (eBits - 1) % windowBits + 1;
+    size_t iBit = eBits - firstBits;
+    sec_tabselect( a, table, n, numEntries, exponentWindow( e, eDigits, iBit, firstBits ) );
+
+    while( iBit > 0 )
+    {
+        iBit -= windowBits;
+        for( size_t iSquare = 0; iSquare < windowBits; ++iSquare )
+            sec_mulredc_1( a, a, a, m, n, mInv, t );
+
+        sec_tabselect( entry, table, n, numEntries, exponentWindow( e, eDigits, iBit, windowBits ) );
+        sec_mulredc_1( a, a, entry, m, n, mInv, t );
+    }
+
+    // Multiplying by 1 leaves Montgomery form.
+    std::fill( entry, entry + n, 0 );
+    entry[0] = 1;
+    sec_mulredc_1( dst, a, entry, m, n, mInv, t );
+}
+
+}
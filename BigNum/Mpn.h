@@ -0,0 +1,127 @@
+#ifndef __MPN_H__
+#define __MPN_H__
+
+#include "BigNum.h"
+
+// Low-level arithmetic on spans of normalized digits, in the spirit of GMP's mpn layer. Every
+// function works on raw digit_t pointers and lengths supplied by the caller, never allocates, and
+// never looks past the lengths it is given, so hot loops can run on buffers the caller manages
+// itself, e.g., on the stack or inside a BigNum via BigNum::writeDigits. BigNum's own arithmetic
+// is built on these functions.
+//
+// Unless noted otherwise, a destination may be the same array as a source, but must not partially
+// overlap one. Lengths may be zero. Where the in-place form has a vectorized kernel in
+// DigitKernels, that kernel is used.
+namespace mpn
+{
+typedef BigNum::digit_t digit_t;
+
+// dst[0..n) = a[0..n) + b[0..n). Returns the carry out of the last digit.
+digit_t add_n( digit_t * dst, const digit_t * a, const digit_t * b, size_t n );
+
+// dst[0..n) = a[0..n) - b[0..n). Returns the borrow out of the last digit.
+digit_t sub_n( digit_t * dst, const digit_t * a, const digit_t * b, size_t n );
+
+// dst[0..n) = a[0..n) + b for a single digit b. Returns the carry out of the last digit. When dst
+// is a, this stops as soon as the carry dies out.
+digit_t add_1( digit_t * dst, const digit_t * a, size_t n, digit_t b );
+
+// dst[0..n) = a[0..n) - b for a single digit b. Returns the borrow out of the last digit. When dst
+// is a, this stops as soon as the borrow dies out.
+digit_t sub_1( digit_t * dst, const digit_t * a, size_t n, digit_t b );
+
+// dst[0..an) = a[0..an) + b[0..bn) for an >= bn. Returns the carry out of the last digit.
+digit_t add( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn );
+
+// dst[0..an) = a[0..an) - b[0..bn) for an >= bn. Returns the borrow out of the last digit.
+digit_t sub( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn );
+
+// dst[0..n) = a[0..n) * b. Returns the most significant digit of the product.
+digit_t mul_1( digit_t * dst, const digit_t * a, size_t n, digit_t b );
+
+// dst[0..n) += a[0..n) * b. Returns the digit carried out, which the caller adds at dst[n]. dst
+// must not overlap a.
+digit_t addmul_1( digit_t * dst, const digit_t * a, size_t n, digit_t b );
+
+// dst[0..n) -= a[0..n) * b. Returns the digit borrowed out, which the caller subtracts at dst[n].
+// dst must not overlap a.
+digit_t submul_1( digit_t * dst, const digit_t * a, size_t n, digit_t b );
+
+// dst[0..an + bn) = a[0..an) * b[0..bn) with Comba's column-wise method. dst must not overlap
+// either factor.
+void mul_basecase( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn );
+
+// Computes just the columns [firstColumn, endColumn) of a * b into dst[firstColumn..endColumn).
+// The carries out of the columns below firstColumn are dropped, so the digits written are those
+// of the full product less an error below (firstColumn + 1) * b, and the remaining digits of dst
+// are left untouched. This gives the truncated products behind BigNum::multiplyLow and
+// BigNum::multiplyHigh. dst must not overlap either factor.
+void mul_columns( digit_t * dst, const digit_t * a, size_t an, const digit_t * b, size_t bn,
+    size_t firstColumn, size_t endColumn );
+
+// dst[0..2n) = a[0..n)^2, computing every cross product only once. dst must not overlap a.
+void sqr_basecase( digit_t * dst, const digit_t * a, size_t n );
+
+// dst[0..n) = a[0..n) << numBits for 0 < numBits < DigitBits. Returns the bits shifted out of the
+// most significant digit. dst may also start above a.
+digit_t lshift( digit_t * dst, const digit_t * a, size_t n, size_t numBits );
+
+// dst[0..n) = a[0..n) >> numBits for 0 < numBits < DigitBits. Returns the bits shifted out of the
+// least significant digit, as an integer less than 2^numBits. dst may also start below a.
+digit_t rshift( digit_t * dst, const digit_t * a, size_t n, size_t numBits );
+
+// Compares a[0..n) with b[0..n).
+Comparison cmp( const digit_t * a, const digit_t * b, size_t n );
+
+// Copies the digits of a nonnegative x < b^n into dst[0..n), padding them with zeros.
+void copy_padded( digit_t * dst, const BigNum & x, size_t n );
+
+// Returns the inverse of an odd digit d modulo b, found by Hensel lifting.
+digit_t binvert_1( digit_t d );
+
+// Montgomery reduction of t[0..2n] by the n digit odd modulus m, where mInv = -m^-1 mod b. Leaves
+// t * b^-n mod m in dst[0..n) for t < m * b^n. t is used as scratch space and must have 2n + 1
+// digits, the last of which must be zero. dst must not overlap m, but may overlap t.
+void redc_1( digit_t * dst, digit_t * t, const digit_t * m, size_t n, digit_t mInv );
+
+// Montgomery multiplication with Coarsely Integrated Operand Scanning (CIOS): leaves
+// x * y * b^-n mod m in dst[0..n) for x[0..xn) and y[0..yn) less than m, where xn, yn <= n and
+// mInv = -m^-1 mod b. Each digit of x is multiplied in and reduced away in a single pass over the
+// n + 1 digits of t, which is used as scratch space. dst may be t, x or y, but must not overlap m.
+void mulredc_1( digit_t * dst, const digit_t * x, size_t xn, const digit_t * y, size_t yn,
+    const digit_t * m, size_t n, digit_t mInv, digit_t * t );
+
+// The functions below run in time independent of the values of their operands, and access memory
+// independently of them, for code that handles secrets such as private keys. Only the lengths and
+// anything explicitly noted as public may influence either.
+
+// dst[0..n) = a[0..n) + b[0..n) if cnd is nonzero, else a[0..n). Returns the carry out of the last
+// digit.
+digit_t cnd_add_n( digit_t cnd, digit_t * dst, const digit_t * a, const digit_t * b, size_t n );
+
+// dst[0..n) = a[0..n) - b[0..n) if cnd is nonzero, else a[0..n). Returns the borrow out of the last
+// digit.
+digit_t cnd_sub_n( digit_t cnd, digit_t * dst, const digit_t * a, const digit_t * b, size_t n );
+
+// Copies entry iEntry of a table of numEntries consecutive n digit entries to dst[0..n), reading
+// every entry of the table to do so.
+void sec_tabselect( digit_t * dst, const digit_t * table, size_t n, size_t numEntries,
+    size_t iEntry );
+
+// mulredc_1 for n digit x and y with a final subtraction that is masked rather than skipped.
+void sec_mulredc_1( digit_t * dst, const digit_t * x, const digit_t * y,
+    const digit_t * m, size_t n, digit_t mInv, digit_t * t );
+
+// Number of digits of scratch space sec_powm needs.
+size_t sec_powm_itch( size_t n, size_t eBits );
+
+// dst[0..n) = x^e mod m for x[0..n) < m and an exponent e of eBits bits, stored in enough digits to
+// hold them, where mInv = -m^-1 mod b and r and r2 hold R mod m and R^2 mod m for R = b^n. Only n
+// and eBits are public, so eBits should be a bound that doesn't depend on e, such as the number of
+// bits in m. dst must not overlap the other spans.
+void sec_powm( digit_t * dst, const digit_t * x, const digit_t * e, size_t eBits,
+    const digit_t * m, size_t n, digit_t mInv, const digit_t * r, const digit_t * r2,
+    digit_t * scratch );
+}
+
+#endif
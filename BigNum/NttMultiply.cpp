@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "NttMultiply.h"
+
+namespace
+{
+
+typedef BigNum::digit_t digit_t;
+typedef BigNum::word_t word_t;
+
+// Number of bits of the factors that go into each transform coefficient. With n coefficients per
+// factor, each convolution coefficient is below n * 2^60, which has to stay below the product of
+// the three primes (about 2^88).
+constexpr unsigned CoefficientBits = 30;
+constexpr uint32_t CoefficientMask = (1u << CoefficientBits) - 1;
+
+// Largest transform length supported by all three primes. 998244353 - 1 = 119 * 2^23 limits it.
+constexpr unsigned MaxTransformLog = 23;
+
+// Arithmetic modulo a prime p < 2^30. Multiplication uses Montgomery reduction with R = 2^32.
+class PrimeField
+{
+public:
+    constexpr PrimeField( uint32_t p, uint32_t generator ) :
+        m_p( p ), m_pInv( negativeInverse( p ) ), m_generator( generator ) { }
+
+    uint32_t prime() const { return m_p; }
+
+    // Reduces a < 2^30 modulo p. Every prime is above 2^28, so this takes at most three
+    // subtractions.
+    uint32_t reduce( uint32_t a ) const
+    {
+        while( a >= m_p )
+            a -= m_p;
+
+        return a;
+    }
+
+    uint32_t add( uint32_t a, uint32_t b ) const
+    {
+        const uint32_t sum = a + b;
+        return sum >= m_p ? sum - m_p : sum;
+    }
+
+    uint32_t subtract( uint32_t a, uint32_t b ) const
+    {
+        return a >= b ? a - b : a + m_p - b;
+    }
+
+    // Computes a * b * R^-1 mod p.
+    uint32_t montgomeryMultiply( uint32_t a, uint32_t b ) const
+    {
+        const uint64_t t = static_cast<uint64_t>(a) * b;
+        const uint32_t m = static_cast<uint32_t>(t) * m_pInv;
+        const auto u = static_cast<uint32_t>((t + static_cast<uint64_t>(m) * m_p) >> 32);
+        return u >= m_p ? u - m_p : u;
+    }
+
+    // Plain modular arithmetic, used to set up constants.
+    uint32_t multiply( uint32_t a, uint32_t b ) const
+    {
+        return static_cast<uint32_t>(static_cast<uint64_t>(a) * b % m_p);
+    }
+
+    uint32_t power( uint32_t base, uint64_t exponent ) const
+    {
+        uint32_t result = 1;
+        for( ; exponent != 0; exponent >>= 1 )
+        {
+            if( (exponent & 1) != 0 )
+                result = multiply( result, base );
+
+            base = multiply( base, base );
+        }
+
+        return result;
+    }
+
+    uint32_t inverse( uint32_t a ) const { return power( a, m_p - 2 ); }
+
+    // Converts a into Montgomery form, a * R mod p.
+    uint32_t toMontgomery( uint32_t a ) const
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(a) << 32) % m_p);
+    }
+
+    // Primitive root of unity of order 2^log.
+    uint32_t rootOfUnity( unsigned log ) const
+    {
+        return power( m_generator, (m_p - 1) >> log );
+    }
+
+private:
+    // -p^-1 mod 2^32 by Newton's iteration.
+    static constexpr uint32_t negativeInverse( uint32_t p )
+    {
+        return 0u - newtonStep( newtonStep( newtonStep( newtonStep( p, p ), p ), p ), p );
+    }
+
+    static constexpr uint32_t newtonStep( uint32_t x, uint32_t p )
+    {
+        return x * (2u - p * x);
+    }
+
+    uint32_t m_p;
+    uint32_t m_pInv;
+    uint32_t m_generator;
+};
+
+constexpr PrimeField Fields[] =
+{
+    PrimeField( 998244353, 3 ),   // 119 * 2^23 + 1
+    PrimeField( 754974721, 11 ),  // 45 * 2^24 + 1
+    PrimeField( 469762049, 3 )    // 7 * 2^26 + 1
+};
+
+// Transforms of length 2^log over one prime field. The forward transform is a decimation in
+// frequency that takes coefficients in natural order and leaves the result in bit reversed order.
+// The inverse transform is a decimation in time that takes bit reversed input back to natural
+// order, so no explicit bit reversal pass is ever needed. Twiddle factors are kept in Montgomery
+// form, which makes a Montgomery multiplication by one the same as an ordinary multiplication.
+class Transform
+{
+public:
+    Transform( const PrimeField & field, unsigned log ) :
+        m_field( field ),
+        m_length( size_t( 1 ) << log ),
+        m_roots( m_length ),
+        m_inverseRoots( m_length )
+    {
+        if( m_length < 2 )
+            return;
+
+        // The twiddles for the stage with butterflies of size 2h are stored at [h, 2h). Those of
+        // the last stage are the powers of a primitive root of unity of order 2^log, and every
+        // other stage uses every other twiddle of the stage after it.
+        const size_t top = m_length / 2;
+        const uint32_t root = field.toMontgomery( field.rootOfUnity( log ) );
+        const uint32_t inverseRoot = field.toMontgomery( field.inverse( field.rootOfUnity( log ) ) );
+        uint32_t w = field.toMontgomery( 1 );
+        uint32_t inverseW = w;
+
+        for( size_t j = 0; j < top; ++j )
+        {
+            m_roots[top + j] = w;
+            m_inverseRoots[top + j] = inverseW;
+            w = field.montgomeryMultiply( w, root );
+            inverseW = field.montgomeryMultiply( inverseW, inverseRoot );
+        }
+
+        for( size_t half = top / 2; half >= 1; half /= 2 )
+        {
+            for( size_t j = 0; j < half; ++j )
+            {
+                m_roots[half + j] = m_roots[2 * half + 2 * j];
+                m_inverseRoots[half + j] = m_inverseRoots[2 * half + 2 * j];
+            }
+        }
+    }
+
+    void forward( uint32_t * a ) const
+    {
+        // Writes through a could alias the field constants and the twiddles as far as the compiler
+        // knows, so keep local copies to let them stay in registers.
+        const PrimeField field = m_field;
+        const uint32_t * roots = m_roots.data();
+
+        for( size_t half = m_length / 2; half >= 1; half /= 2 )
+        {
+            for( size_t iBlock = 0; iBlock < m_length; iBlock += 2 * half )
+            {
+                for( size_t j = 0; j < half; ++j )
+                {
+                    const uint32_t u = a[iBlock + j];
+                    const uint32_t v = a[iBlock + j + half];
+                    a[iBlock + j] = field.add( u, v );
+                    a[iBlock + j + half] = field.montgomeryMultiply(
+                        field.subtract( u, v ), roots[half + j] );
+                }
+            }
+        }
+    }
+
+    void inverse( uint32_t * a ) const
+    {
+        // Local copies for the same reason as in forward().
+        const PrimeField field = m_field;
+        const uint32_t * roots = m_inverseRoots.data();
+
+        for( size_t half = 1; half < m_length; half *= 2 )
+        {
+            for( size_t iBlock = 0; iBlock < m_length; iBlock += 2 * half )
+            {
+                for( size_t j = 0; j < half; ++j )
+                {
+                    const uint32_t u = a[iBlock + j];
+                    const uint32_t v = field.montgomeryMultiply( a[iBlock + j + half],
+                        roots[half + j] );
+                    a[iBlock + j] = field.add( u, v );
+                    a[iBlock + j + half] = field.subtract( u, v );
+                }
+            }
+        }
+    }
+
+private:
+    const PrimeField & m_field;
+    size_t m_length;
+    std::vector<uint32_t> m_roots;
+    std::vector<uint32_t> m_inverseRoots;
+};
+
+size_t numberCoefficients( size_t numDigits )
+{
+    return (numDigits * DigitBits + CoefficientBits - 1) / CoefficientBits;
+}
+
+// Cuts the bits of a digit array into CoefficientBits sized coefficients, reduced modulo p. The
+// rest of the coefficients up to the transform length are zeroed.
+void loadCoefficients( const digit_t * digits, size_t numDigits, const PrimeField & field,
+    std::vector<uint32_t> & coefficients )
+{
+    word_t buffer = 0;
+    unsigned bufferBits = 0;
+    size_t iDigit = 0;
+
+    for( auto & coefficient : coefficients )
+    {
+        while( bufferBits < CoefficientBits && iDigit < numDigits )
+        {
+            buffer |= static_cast<word_t>(digits[iDigit++]) << bufferBits;
+            bufferBits += DigitBits;
+        }
+
+        coefficient = field.reduce( static_cast<uint32_t>(buffer & CoefficientMask) );
+        buffer >>= CoefficientBits;
+        bufferBits = bufferBits > CoefficientBits ? bufferBits - CoefficientBits : 0;
+    }
+}
+
+// Convolves the coefficients of lhs and rhs modulo one prime. The result is left in lhs.
+void convolve( const Transform & transform, const PrimeField & field, size_t length,
+    std::vector<uint32_t> & lhs, std::vector<uint32_t> * rhs )
+{
+    transform.forward( lhs.data() );
+
+    if( rhs != nullptr )
+        transform.forward( rhs->data() );
+
+    const std::vector<uint32_t> & other = rhs != nullptr ? *rhs : lhs;
+    for( size_t i = 0; i < length; ++i )
+        lhs[i] = field.montgomeryMultiply( lhs[i], other[i] );
+
+    transform.inverse( lhs.data() );
+
+    // The pointwise products carry a factor of R^-1 and the inverse transform a factor of the
+    // length. A Montgomery multiplication by R^2 / length removes both.
+    const uint32_t scale = field.multiply( field.toMontgomery( field.toMontgomery( 1 ) ),
+        field.inverse( static_cast<uint32_t>(length % field.prime()) ) );
+
+    for( size_t i = 0; i < length; ++i )
+        lhs[i] = field.montgomeryMultiply( lhs[i], scale );
+}
+
+// 128-bit unsigned integer made of two 64-bit halves, enough for the recombined coefficients.
+struct Wide
+{
+    uint64_t low;
+    uint64_t high;
+
+    void add( uint64_t valueLow, uint64_t valueHigh )
+    {
+        low += valueLow;
+        high += valueHigh + (low < valueLow ? 1 : 0);
+    }
+};
+
+// Computes a * b for a < 2^64 and b < 2^32.
+Wide multiplyWide( uint64_t a, uint32_t b )
+{
+    const uint64_t lowProduct = (a & 0xffffffff) * b;
+    const uint64_t highProduct = (a >> 32) * b;
+
+    Wide result{ lowProduct, highProduct >> 32 };
+    result.add( highProduct << 32, 0 );
+    return result;
+}
+
+}
+
+size_t nttMaxProductDigits()
+{
+    // Leave room for the coefficients lost to rounding when each factor is cut up.
+    return ((size_t( 1 ) << MaxTransformLog) - 2) * CoefficientBits / DigitBits;
+}
+
+void nttMultiply( digit_t * dst, const digit_t * lhs, size_t lhsDigits,
+    const digit_t * rhs, size_t rhsDigits )
+{
+    const size_t numDigits = lhsDigits + rhsDigits;
+    const bool isSquare = (lhs == rhs && lhsDigits == rhsDigits);
+
+    if( lhsDigits == 0 || rhsDigits == 0 )
+    {
+        std::fill( dst, dst + numDigits, 0 );
+        return;
+    }
+
+    if( numDigits > nttMaxProductDigits() )
+        throw std::invalid_argument( "Product is too large for NTT multiplication." );
+
+    const size_t productCoefficients = numberCoefficients( lhsDigits ) +
+        numberCoefficients( rhsDigits ) - 1;
+
+    unsigned log = 0;
+    while( (size_t( 1 ) << log) < productCoefficients )
+        ++log;
+
+    const size_t length = size_t( 1 ) << log;
+
+    std::vector<uint32_t> residues[3];
+    std::vector<uint32_t> scratch;
+
+    for( size_t iField = 0; iField < 3; ++iField )
+    {
+        const PrimeField & field = Fields[iField];
+        const Transform transform( field, log );
+
+        residues[iField].resize( length );
+        loadCoefficients( lhs, lhsDigits, field, residues[iField] );
+
+        if( isSquare )
+        {
+            convolve( transform, field, length, residues[iField], nullptr );
+        }
+        else
+        {
+            scratch.resize( length );
+            loadCoefficients( rhs, rhsDigits, field, scratch );
+            convolve( transform, field, length, residues[iField], &scratch );
+        }
+    }
+
+    // Recombine each coefficient from its three residues with Garner's algorithm:
+    //   x = r0 + p0 * ((r1 - r0) / p0 mod p1) + p0 * p1 * ((r2 - x01) / (p0 * p1) mod p2),
+    // and add it into the result at bit offset i * CoefficientBits.
+    const PrimeField & f0 = Fields[0];
+    const PrimeField & f1 = Fields[1];
+    const PrimeField & f2 = Fields[2];
+    const uint64_t p01 = static_cast<uint64_t>(f0.prime()) * f1.prime();
+
+    // Constants for field k are kept in Montgomery form so that a Montgomery multiplication by them
+    // is an ordinary modular multiplication.
+    const uint32_t inverseP0 = f1.toMontgomery( f1.inverse( f0.prime() % f1.prime() ) );
+    const uint32_t p0ModP2 = f2.toMontgomery( f0.prime() % f2.prime() );
+    const uint32_t inverseP01 = f2.toMontgomery(
+        f2.inverse( static_cast<uint32_t>(p01 % f2.prime()) ) );
+
+    Wide carry{ 0, 0 };
+    word_t buffer = 0;
+    unsigned bufferBits = 0;
+    size_t iDigit = 0;
+
+    for( size_t i = 0; iDigit < numDigits; ++i )
+    {
+        if( i < productCoefficients )
+        {
+            const uint32_t r0 = residues[0][i];
+            const uint32_t r1 = residues[1][i];
+            const uint32_t r2 = residues[2][i];
+
+            const uint32_t r0ModP1 = f1.reduce( r0 );
+            const uint32_t r0ModP2 = f2.reduce( r0 );
+            const uint32_t t1 = f1.montgomeryMultiply( f1.subtract( r1, r0ModP1 ), inverseP0 );
+            const uint64_t x01 = r0 + static_cast<uint64_t>(f0.prime()) * t1;
+
+            // x01 mod p2, from its two parts.
+            const uint32_t x01ModP2 = f2.add( r0ModP2, f2.montgomeryMultiply( t1, p0ModP2 ) );
+            const uint32_t t2 = f2.montgomeryMultiply( f2.subtract( r2, x01ModP2 ), inverseP01 );
+
+            const Wide term = multiplyWide( p01, t2 );
+            carry.add( x01, 0 );
+            carry.add( term.low, term.high );
+        }
+
+        // Emit the low CoefficientBits bits of the running sum and shift it down.
+        buffer |= static_cast<word_t>(carry.low & CoefficientMask) << bufferBits;
+        bufferBits += CoefficientBits;
+        carry.low = (carry.low >> CoefficientBits) | (carry.high << (64 - CoefficientBits));
+        carry.high >>= CoefficientBits;
+
+        while( bufferBits >= DigitBits && iDigit < numDigits )
+        {
+            dst[iDigit++] = static_cast<digit_t>(buffer & DigitMask);
+            buffer >>= DigitBits;
+            bufferBits -= DigitBits;
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef __NTT_MULTIPLY_H__
+#define __NTT_MULTIPLY_H__
+
+#include "BigNum.h"
+
+// Number theoretic transform multiplication of raw digit arrays, used as the top tier of BigNum's
+// multiplication dispatch.
+//
+// The factors are cut into 30-bit coefficients and convolved modulo three NTT-friendly primes just
+// under 2^30. Every coefficient of the exact convolution is below the product of the three primes,
+// so the Chinese remainder theorem recovers it exactly from the three residues. Only integer
+// arithmetic is involved, so the result is always exact.
+
+// Largest product, in digits, that nttMultiply can compute. This is bounded by the largest
+// power-of-two transform the three primes support.
+size_t nttMaxProductDigits();
+
+// Computes lhs * rhs into dst, which must have room for lhsDigits + rhsDigits digits and must not
+// overlap either factor. Squaring is detected when lhs and rhs are the same array, in which case
+// only one forward transform is computed.
+void nttMultiply( BigNum::digit_t * dst, const BigNum::digit_t * lhs, size_t lhsDigits,
+    const BigNum::digit_t * rhs, size_t rhsDigits );
+
+#endif
@@ -1,91 +1,27 @@
-﻿#include <stdexcept>
+﻿#include <algorithm>
+#include <stdexcept>
 
+#include "Mpn.h"
 #include "RsaMath.h"
+#include "SlidingWindow.h"
 
-// Adapted from binary extended GCD algorithm given in section 14.4.3 in Handbook of Applied
-// Cryptography. This is designed specifically for computing a value N' = -N^-1 mod b for an
-// RSA modulus N (i.e., the product of two large primes). Here, b is the BigNum radix, which
-// is a power of two.
+// Computes N' = -N^-1 mod b for an RSA modulus N (i.e., the product of two large primes), where b
+// is the BigNum radix. Since b is a power of two, only the least significant digit of N matters,
+// and its inverse comes from Hensel lifting in a handful of single digit multiplications.
 //
-// The value N' is guaranteed to exist because N and b are coprime. By extension, this means
-// N and R = b^l are also coprime, where l is the number of base-b digits in N. Consequently,
+// The value N' is guaranteed to exist because N is odd, so N and b are coprime. By extension, this
+// means N and R = b^l are also coprime, where l is the number of base-b digits in N. Consequently,
 // the value returned by this function is sufficient for use in Montgomery multiplication and,
 // by extension, Montgomery exponentiation.
 //
 BigNum::digit_t compute_montgomery_inverse( const BigNum & n )
 {
-    // Represent our radix, which is 2^(DigitBits). For purposes of corresponding with variables
-    // given in HAC, n and b here refer to x and y in HAC, respectively.
-    BigNum b;
-    b = 1;
-    b <<= DigitBits;
-
-    BigNum u( n );
-    BigNum v( b );
-
-    BigNum A;
-    BigNum B;
-    BigNum C;
-    BigNum D;
-
-    A = 1;
-    D = 1;
-
-    do
-    {
-        while( u.isEven() )
-        {
-            u.divideByTwo();
-
-            if( A.isOdd() || B.isOdd() )
-            {
-                A += b;
-                B -= n;
-            }
-
-            A.divideByTwo();
-            B.divideByTwo();
-        }
-
-        while( v.isEven() )
-        {
-            v.divideByTwo();
-
-            if( C.isOdd() || D.isOdd() )
-            {
-                C += b;
-                D -= n;
-            }
-
-            C.divideByTwo();
-            D.divideByTwo();
-        }
-
-        if( u.compare( v ) != Comparison::LessThan )
-        {
-            u -= v;
-            A -= C;
-            B -= D;
-        }
-        else
-        {
-            v -= u;
-            C -= A;
-            D -= B;
-        }
-    } while( !u.isZero() );
-
-    // If v is not 1, then we somehow picked a bad RSA modulus, because it means that n and b
-    // are NOT coprime, which is a precondition for this function.
-    BigNum one;
-    one = 1;
-    if( v.compare( one ) != Comparison::Equal )
+    // If n is even, then we somehow picked a bad RSA modulus, because it means that n and b are
+    // NOT coprime, which is a precondition for this function.
+    if( n.isEven() )
         throw std::invalid_argument( "n must be coprime to be" );
 
-    // Montgomery multiplication requires N' to be -N^-1 mod b. C contains our computed inverse
-    // for N, though it may not be reduced mod b. Negate the inverse and reduce it mod b. Since
-    // the result is reduced mod b, the final answer is in the least significant digit of C.
-    return C.negate().mod( b ).getDigit( 0 );
+    return (DigitRadix - mpn::binvert_1( n.getDigit( 0 ) )) & DigitMask;
 }
 
 // Based on Algorithm 14.36 in Handbook of Applied Cryptography.
@@ -93,65 +29,101 @@ BigNum montgomery_multiply( const BigNum & x, const BigNum & y,
     const BigNum & m, BigNum::digit_t mInv )
 {
     const size_t numberDigits = m.numberDigits();
-    BigNum a( m.numberDigits() );
 
-    const auto y0 = static_cast<BigNum::word_t>(y.getDigit( 0 ));
-    const auto mInvWord = static_cast<BigNum::word_t>(mInv);
-    constexpr const auto digitMask = static_cast<const BigNum::word_t>(DigitMask);
-
-    // These are used to hold the result of xi * y and ui * m inside the following loop.
-    BigNum xiy( y.numberDigits() + 1 );
-    BigNum uim( m.numberDigits() + 1 );
-
-    for( size_t iDigit = 0; iDigit < numberDigits; ++iDigit )
-    {
-        const auto a0 = static_cast<BigNum::word_t>(a.getDigit( 0 ));
-        const auto xi = static_cast<BigNum::word_t>(x.getDigit( iDigit ));
-
-        // Compute ui = (a0 + xi * y0) * m' (mod b). Perform the mod b operation at each step to
-        // avoid overflowing the double precision word.
-        auto ui = static_cast<BigNum::digit_t>(
-            (((a0 + (xi * y0) & digitMask) & digitMask) * mInv) & digitMask
-        );
-
-        // Compute A = (A + xi * y + ui * m) / b.
-        xiy = y * static_cast<BigNum::digit_t>(xi);
-        uim = m * ui;
-        a += (xiy + uim);
-        a.rightDigitShift( 1 );
-    }
-
-    if( a.compare( m ) != Comparison::LessThan )
-        a -= m;
+    // Multiply and reduce in a single pass over the n + 1 digits of the result, which stay in the
+    // number's inline storage. x and y can have fewer digits than m.
+    BigNum a;
+    BigNum::digit_t * t = a.writeDigits( numberDigits + 1 );
+    mpn::mulredc_1( t, x.readDigits(), x.numberDigits(), y.readDigits(), y.numberDigits(),
+        m.readDigits(), numberDigits, mInv, t );
 
+    a.finishDigits( numberDigits );
     return a;
 }
 
-// Based on HAC algorithm 14.94.
+// Computes x^2 * R^-1 mod m for 0 <= x < m. Forming the square with the squaring kernel and
+// reducing it separately saves about half the digit multiplications, but at RSA sizes that is
+// still slower than the single pass of montgomery_multiply, since the separate reduction costs a
+// second pass with its own carries.
+BigNum montgomery_square( const BigNum & x, const BigNum & m, BigNum::digit_t mInv )
+{
+    return montgomery_multiply( x, x, m, mInv );
+}
+
+// Based on HAC algorithm 14.94, with the sliding windows of HAC algorithm 14.85, or the short
+// path in SlidingWindow.h for short exponents.
 BigNum montgomery_exponentiation( const BigNum & x, const BigNum & e,
     const BigNum & m, BigNum::digit_t mInv,
     const BigNum & r, const BigNum & r2 )
 {
-    const BigNum xBar( montgomery_multiply( x, r2, m, mInv ) );
-    BigNum a( r );
+    if( isShortExponent( e ) )
+    {
+        const BigNum xBar( montgomery_multiply( x, r2, m, mInv ) );
+        BigNum a( r );
+        shortExponentiation( e.getDigit( 0 ),
+            [&]() { a = montgomery_square( a, m, mInv ); },
+            [&]() { a = montgomery_multiply( a, xBar, m, mInv ); },
+            [&]() { a = xBar; } );
+
+        return montgomery_multiply( a, x, m, mInv );
+    }
 
-    auto iExponentBits = e.createBiterator();
-    while( iExponentBits.hasBits() )
+    // Odd powers of xBar = x * R mod m, i.e., xBar, xBar^3, xBar^5, ... in Montgomery form.
+    const size_t windowBits = slidingWindowBits( e.numberBits() );
+    std::vector<BigNum> powers( size_t( 1 ) << (windowBits - 1) );
+    powers[0] = montgomery_multiply( x, r2, m, mInv );
+    if( powers.size() > 1 )
     {
-        a = montgomery_multiply( a, a, m, mInv );
-        if( iExponentBits.nextBit() != 0 )
-            a = montgomery_multiply( a, xBar, m, mInv );
+        const BigNum xBar2( montgomery_square( powers[0], m, mInv ) );
+        for( size_t iPower = 1; iPower < powers.size(); ++iPower )
+            powers[iPower] = montgomery_multiply( powers[iPower - 1], xBar2, m, mInv );
     }
 
+    BigNum a( r );
+    slidingWindowExponentiation( e, windowBits,
+        [&]() { a = montgomery_square( a, m, mInv ); },
+        [&]( size_t iPower ) { a = montgomery_multiply( a, powers[iPower], m, mInv ); },
+        [&]( size_t iPower ) { a = powers[iPower]; } );
+
     BigNum one;
     one = 1;
 
     return montgomery_multiply( a, one, m, mInv );
 }
 
-void rsaEncrypt( const uint8_t * input, size_t inputLength, uint8_t * output, size_t outputLength,
-    const BigNum & n, const BigNum & e, BigNum::digit_t nInv,
+BigNum constant_time_montgomery_exponentiation( const BigNum & x, const BigNum & e,
+    const BigNum & m, BigNum::digit_t mInv,
     const BigNum & r, const BigNum & r2 )
+{
+    const size_t n = m.numberDigits();
+    const size_t eBits = std::max( e.numberBits(), m.numberBits() );
+    const size_t eDigits = (eBits + DigitBits - 1) / DigitBits;
+
+    // x, r, r2 and e padded out to their full lengths, followed by the scratch space for sec_powm.
+    std::vector<BigNum::digit_t> digits( 3 * n + eDigits + mpn::sec_powm_itch( n, eBits ), 0 );
+    BigNum::digit_t * padded = digits.data();
+    for( const BigNum * value : { &x, &r, &r2, &e } )
+    {
+        std::copy( value->readDigits(), value->readDigits() + value->numberDigits(), padded );
+        padded += n;
+    }
+
+    BigNum result;
+    mpn::sec_powm( result.writeDigits( n ), digits.data(), digits.data() + 3 * n, eBits,
+        m.readDigits(), n, mInv, digits.data() + n, digits.data() + 2 * n,
+        digits.data() + 3 * n + eDigits );
+    result.finishDigits( n );
+    return result;
+}
+
+namespace
+{
+
+// Splits the input into blocks one byte shorter than the modulus, raises each of them to the
+// public exponent with exponentiate, and writes the results out in blocks as long as the modulus.
+template<typename Exponentiate>
+void encryptBlocks( const uint8_t * input, size_t inputLength, uint8_t * output, size_t outputLength,
+    const BigNum & n, Exponentiate exponentiate )
 {
     const size_t rsaBitLength = n.numberBits();
     const size_t bytesPerInputBlock = (rsaBitLength - 1) / 8;
@@ -173,7 +145,7 @@ void rsaEncrypt( const uint8_t * input, size_t inputLength, uint8_t * output, si
         bytesRead += bytesPerInputBlock, bytesWritten += bytesPerOutputBlock )
     {
         inputBlock.loadBytes( input + bytesRead, bytesPerInputBlock );
-        outputBlock = montgomery_exponentiation( inputBlock, e, n, nInv, r, r2 );
+        outputBlock = exponentiate( inputBlock );
         outputBlock.storeBytes( output + bytesWritten, bytesPerOutputBlock );
     }
 
@@ -181,15 +153,16 @@ void rsaEncrypt( const uint8_t * input, size_t inputLength, uint8_t * output, si
     if( bytesRead != inputLength )
     {
         inputBlock.loadBytes( input + bytesRead, inputLength - bytesRead );
-        outputBlock = montgomery_exponentiation( inputBlock, e, n, nInv, r, r2 );
+        outputBlock = exponentiate( inputBlock );
         outputBlock.storeBytes( output + bytesWritten, bytesPerOutputBlock );
     }
 }
 
-void rsaDecrypt( const uint8_t * input, size_t inputLength,
+// The inverse of encryptBlocks, with exponentiate raising each block to the private exponent.
+template<typename Exponentiate>
+void decryptBlocks( const uint8_t * input, size_t inputLength,
     uint8_t * output, size_t outputLength, size_t & outputBytesWritten,
-    const BigNum & n, const BigNum & e, BigNum::digit_t nInv,
-    const BigNum & r, const BigNum & r2 )
+    const BigNum & n, Exponentiate exponentiate )
 {
     const size_t bytesPerInputBlock = n.numberBytes();
 
@@ -205,7 +178,7 @@ void rsaDecrypt( const uint8_t * input, size_t inputLength,
         bytesRead += bytesPerInputBlock )
     {
         inputBlock.loadBytes( input + bytesRead, bytesPerInputBlock );
-        outputBlock = montgomery_exponentiation( inputBlock, e, n, nInv, r, r2 );
+        outputBlock = exponentiate( inputBlock );
         const size_t numOutputBytes = outputBlock.numberBytes();
 
         if( (outputBytesWritten + numOutputBytes) > outputLength )
@@ -214,4 +187,48 @@ void rsaDecrypt( const uint8_t * input, size_t inputLength,
         outputBlock.storeBytes( output + outputBytesWritten, numOutputBytes );
         outputBytesWritten += numOutputBytes;
     }
-}
\ No newline at end of file
+}
+
+}
+
+void rsaEncrypt( const uint8_t * input, size_t inputLength, uint8_t * output, size_t outputLength,
+    const BigNum & n, const BigNum & e, BigNum::digit_t nInv,
+    const BigNum & r, const BigNum & r2 )
+{
+    encryptBlocks( input, inputLength, output, outputLength, n,
+        [&]( const BigNum & x ) { return montgomery_exponentiation( x, e, n, nInv, r, r2 ); } );
+}
+
+void rsaEncrypt( const uint8_t * input, size_t inputLength, uint8_t * output, size_t outputLength,
+    const MontgomeryContext & context, const BigNum & e )
+{
+    encryptBlocks( input, inputLength, output, outputLength, context.modulus(),
+        [&]( const BigNum & x ) { return context.exp( x, e ); } );
+}
+
+void rsaDecrypt( const uint8_t * input, size_t inputLength,
+    uint8_t * output, size_t outputLength, size_t & outputBytesWritten,
+    const BigNum & n, const BigNum & e, BigNum::digit_t nInv,
+    const BigNum & r, const BigNum & r2 )
+{
+    decryptBlocks( input, inputLength, output, outputLength, outputBytesWritten, n,
+        [&]( const BigNum & x )
+        {
+            return constant_time_montgomery_exponentiation( x, e, n, nInv, r, r2 );
+        } );
+}
+
+void rsaDecrypt( const uint8_t * input, size_t inputLength,
+    uint8_t * output, size_t outputLength, size_t & outputBytesWritten,
+    const MontgomeryContext & context, const BigNum & e )
+{
+    decryptBlocks( input, inputLength, output, outputLength, outputBytesWritten, context.modulus(),
+        [&]( const BigNum & x ) { return context.expConstantTime( x, e ); } );
+}
+
+void rsaDecryptCrt( const uint8_t * input, size_t inputLength,
+    uint8_t * output, size_t outputLength, size_t & outputBytesWritten, const RsaPrivateKey & key )
+{
+    decryptBlocks( input, inputLength, output, outputLength, outputBytesWritten, key.modulus(),
+        [&]( const BigNum & x ) { return key.decrypt( x ); } );
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <vector>
+
+#include "Gcd.h"
+#include "Mpn.h"
+#include "RsaPrivateKey.h"
+
+namespace
+{
+
+typedef BigNum::digit_t digit_t;
+
+BigNum reduceExponent( const BigNum & d, const BigNum & prime )
+{
+    BigNum one;
+    one = 1;
+
+    BigNum exponent( d );
+    return exponent.mod( prime - one );
+}
+
+// dst[0..n) = x[0..xn) mod m for the n digit modulus m of context, using scratch[0..4n] as scratch.
+// x is split into n digit chunks x_i, each of which is below R = b^n, so the Montgomery product of
+// x_i and R^(i + 1) mod m is below 2m and gives x_i * R^i mod m. The chunks are summed with masked
+// subtractions, so only xn and n affect the time taken.
+void reduceModulo( digit_t * dst, const digit_t * x, size_t xn, const MontgomeryContext & context,
+    digit_t * scratch )
+{
+    const digit_t * m = context.modulus().readDigits();
+    const size_t n = context.modulus().numberDigits();
+    digit_t * t = scratch;
+    digit_t * chunk = t + n + 1;
+    digit_t * rPower = chunk + n;
+    digit_t * r2 = rPower + n;
+
+    mpn::copy_padded( rPower, context.r(), n );
+    mpn::copy_padded( r2, context.r2(), n );
+    std::fill( dst, dst + n, 0 );
+
+    for( size_t iDigit = 0; iDigit < xn; iDigit += n )
+    {
+        if( iDigit != 0 )
+            mpn::sec_mulredc_1( rPower, rPower, r2, m, n, context.nInv(), t );
+
+        const size_t numChunkDigits = std::min( n, xn - iDigit );
+        std::copy( x + iDigit, x + iDigit + numChunkDigits, chunk );
+        std::fill( chunk + numChunkDigits, chunk + n, 0 );
+        mpn::sec_mulredc_1( chunk, chunk, rPower, m, n, context.nInv(), t );
+
+        // dst + chunk < 2m, which is below m again after subtracting m unless that goes negative.
+        const digit_t carry = mpn::cnd_add_n( 1, dst, dst, chunk, n );
+        const digit_t borrow = mpn::cnd_sub_n( 1, dst, dst, m, n );
+        mpn::cnd_add_n( borrow & (carry ^ 1), dst, dst, m, n );
+    }
+}
+
+}
+
+RsaPrivateKey::RsaPrivateKey( const BigNum & p, const BigNum & q, const BigNum & d ) :
+    RsaPrivateKey( p, q, reduceExponent( d, p ), reduceExponent( d, q ), modInverse( q, p ) )
+{
+}
+
+RsaPrivateKey::RsaPrivateKey( const BigNum & p, const BigNum & q,
+    const BigNum & dp, const BigNum & dq, const BigNum & qInv ) :
+    m_p( p ), m_q( q ), m_dp( dp ), m_dq( dq ), m_qInv( qInv ),
+    m_qInvBar( m_p.toMontgomery( qInv ) ), m_n( p * q )
+{
+}
+
+// Garner's formula (HAC Note 14.75): with m1 = c^dp mod p and m2 = c^dq mod q, the plaintext is
+// m2 + h * q for h = qInv * (m1 - m2) mod p. Apart from the exponentiations, everything runs on
+// digit spans padded to the lengths of p, q and n.
+BigNum RsaPrivateKey::decrypt( const BigNum & c ) const
+{
+    const size_t pDigits = p().numberDigits();
+    const size_t qDigits = q().numberDigits();
+    const size_t nDigits = m_n.numberDigits();
+    const size_t mDigits = pDigits + qDigits;
+
+    std::vector<digit_t> digits( nDigits + mDigits + 3 * pDigits +
+        4 * std::max( pDigits, qDigits ) + 1 );
+    digit_t * cDigits = digits.data();
+    digit_t * m2Digits = cDigits + nDigits;
+    digit_t * m1Digits = m2Digits + mDigits;
+    digit_t * h = m1Digits + pDigits;
+    digit_t * qInvBar = h + pDigits;
+    digit_t * scratch = qInvBar + pDigits;
+
+    mpn::copy_padded( cDigits, c, nDigits );
+
+    BigNum cp;
+    reduceModulo( cp.writeDigits( pDigits ), cDigits, nDigits, m_p, scratch );
+    cp.finishDigits( pDigits );
+
+    BigNum cq;
+    reduceModulo( cq.writeDigits( qDigits ), cDigits, nDigits, m_q, scratch );
+    cq.finishDigits( qDigits );
+
+    const BigNum m1( m_p.expConstantTime( cp, m_dp ) );
+    const BigNum m2( m_q.expConstantTime( cq, m_dq ) );
+
+    // m2 can be larger than p if q is the larger prime, so it is reduced modulo p before the
+    // subtraction, which then only needs p added back if it goes negative.
+    mpn::copy_padded( m1Digits, m1, pDigits );
+    mpn::copy_padded( m2Digits, m2, mDigits );
+    reduceModulo( h, m2Digits, qDigits, m_p, scratch );
+
+    const digit_t borrow = mpn::sub_n( h, m1Digits, h, pDigits );
+    mpn::cnd_add_n( borrow, h, h, p().readDigits(), pDigits );
+
+    mpn::copy_padded( qInvBar, m_qInvBar, pDigits );
+    mpn::sec_mulredc_1( h, h, qInvBar, p().readDigits(), pDigits, m_p.nInv(), scratch );
+
+    // h * q + m2 < p * q, so the addition carries nowhere.
+    BigNum result;
+    digit_t * resultDigits = result.writeDigits( mDigits );
+    mpn::mul_basecase( resultDigits, h, pDigits, q().readDigits(), qDigits );
+    mpn::cnd_add_n( 1, resultDigits, resultDigits, m2Digits, mDigits );
+    result.finishDigits( mDigits );
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef __RSA_PRIVATE_KEY_H__
+#define __RSA_PRIVATE_KEY_H__
+
+#include "BigNum.h"
+#include "MontgomeryContext.h"
+
+// RSA private key in the Chinese remainder theorem form of PKCS #1: the primes p and q, the
+// exponents dp = d mod (p - 1) and dq = d mod (q - 1), and qInv = q^-1 mod p. Each prime has its
+// own Montgomery context, so a private-key operation is two exponentiations with half-size moduli
+// and exponents, about a quarter of the work of one exponentiation modulo n. Like
+// MontgomeryContext, a key is immutable and can be shared across threads.
+class RsaPrivateKey
+{
+public:
+    // Derives dp, dq and qInv from the private exponent d. Throws std::invalid_argument if p or q
+    // is not odd and greater than one, or if q is not invertible modulo p.
+    RsaPrivateKey( const BigNum & p, const BigNum & q, const BigNum & d );
+
+    // Takes the CRT components as they are stored in a PKCS #1 key.
+    RsaPrivateKey( const BigNum & p, const BigNum & q,
+        const BigNum & dp, const BigNum & dq, const BigNum & qInv );
+
+    const BigNum & p() const { return m_p.modulus(); }
+    const BigNum & q() const { return m_q.modulus(); }
+    const BigNum & dp() const { return m_dp; }
+    const BigNum & dq() const { return m_dq; }
+    const BigNum & qInv() const { return m_qInv; }
+    const BigNum & modulus() const { return m_n; }
+
+    // Returns c^d mod n for 0 <= c < n. The reductions of c, both exponentiations and the
+    // recombination all run in constant time, using the masked arithmetic in Mpn.h.
+    BigNum decrypt( const BigNum & c ) const;
+
+private:
+    MontgomeryContext m_p;
+    MontgomeryContext m_q;
+    BigNum m_dp;
+    BigNum m_dq;
+    BigNum m_qInv;
+
+    // qInv * R mod p, so that a single Montgomery multiplication gives h = qInv * (m1 - m2) mod p.
+    BigNum m_qInvBar;
+    BigNum m_n;
+};
+
+#endif
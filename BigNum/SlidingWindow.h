@@ -0,0 +1,126 @@
+#ifndef __SLIDING_WINDOW_H__
+#define __SLIDING_WINDOW_H__
+
+#include <algorithm>
+
+#include "BigNum.h"
+
+// Left-to-right sliding-window exponentiation (HAC Algorithm 14.85), shared by the BigNum,
+// FixedBigNum and MontgomeryContext versions of Montgomery exponentiation. Instead of one
+// multiplication for every set bit of the exponent, each run of up to k bits that starts and ends
+// with a one costs a single multiplication by an odd power of x from a table of 2^(k-1) entries.
+// Zero bits between windows only cost squarings.
+//
+// Short exponents, such as the public exponents 3 and 65537, take a simpler path instead.
+
+// Largest window considered. A table of 2^(MaxWindowBits - 1) powers is already 32 KB for a
+// 4096-bit modulus, and wider windows don't pay for their tables below 4608-bit exponents.
+constexpr size_t MaxWindowBits = 7;
+
+// Returns the window width that needs the fewest multiplications for an exponent of the given
+// number of bits. With k bit windows, building the table takes 2^(k-1) multiplications and the
+// exponent takes about one per k + 1 bits, so going from k to k + 1 bits pays off once the
+// exponent has more than 2^(k-1) * (k + 1) * (k + 2) bits.
+inline size_t slidingWindowBits( size_t exponentBits )
+{
+    size_t windowBits = 1;
+    while( windowBits < MaxWindowBits &&
+        exponentBits > (size_t( 1 ) << (windowBits - 1)) * (windowBits + 1) * (windowBits + 2) )
+    {
+        ++windowBits;
+    }
+
+    return windowBits;
+}
+
+// Runs the squarings and multiplications for the exponent e with windows of windowBits bits. The
+// caller owns the accumulator and a table of the odd powers x, x^3, ..., x^(2^windowBits - 1):
+// square() squares the accumulator, multiply( iPower ) multiplies it by x^(2 * iPower + 1), and
+// load( iPower ) sets it to x^(2 * iPower + 1). The first window uses load, since the accumulator
+// would still be one, so it must start out as one only for a zero exponent.
+template <typename Square, typename Multiply, typename Load>
+void slidingWindowExponentiation( const BigNum & e, size_t windowBits,
+    Square square, Multiply multiply, Load load )
+{
+    bool first = true;
+    auto iExponentBits = e.createBiterator();
+
+    while( iExponentBits.hasBits() )
+    {
+        // The biterator starts at the most significant one, so zeros only come after a window.
+        const size_t numZeros = iExponentBits.skipZeros();
+        for( size_t iSquare = 0; iSquare < numZeros; ++iSquare )
+            square();
+
+        if( !iExponentBits.hasBits() )
+            break;
+
+        // The window starts with a one. End it at its last one, and square for the zeros after
+        // that once the multiplication is done.
+        const size_t numBits = std::min( windowBits, iExponentBits.bitsLeft() );
+        BigNum::digit_t window = iExponentBits.nextBits( numBits );
+
+        size_t numTrailingZeros = 0;
+        while( (window & 1) == 0 )
+        {
+            window >>= 1;
+            ++numTrailingZeros;
+        }
+
+        if( first )
+        {
+            load( window >> 1 );
+            first = false;
+        }
+        else
+        {
+            for( size_t iSquare = numTrailingZeros; iSquare < numBits; ++iSquare )
+                square();
+
+            multiply( window >> 1 );
+        }
+
+        for( size_t iSquare = 0; iSquare < numTrailingZeros; ++iSquare )
+            square();
+    }
+}
+
+// Exponents of up to this many bits, e.g., public exponents, take the short path below. They are
+// mostly zeros, so a window table would cost more multiplications than it saves.
+constexpr size_t ShortExponentBits = DigitBits;
+
+// Runs left-to-right binary exponentiation for the exponent e - 1 of a short exponent e >= 1, so
+// the accumulator ends up as xBar^(e - 1) for xBar = x * R mod m. The caller then multiplies that
+// by x itself rather than by xBar, which gives x^(e - 1) * R * x * R^-1 = x^e, so the final
+// multiplication also takes the result out of Montgomery form. For e = 2^k + 1 that is k squarings
+// and a single multiplication, besides converting x. load() sets the accumulator to xBar, and
+// multiply() multiplies it by xBar. The accumulator must start out as one in Montgomery form,
+// i.e., R mod m, for e = 1.
+template <typename Square, typename Multiply, typename Load>
+void shortExponentiation( BigNum::digit_t e, Square square, Multiply multiply, Load load )
+{
+    const BigNum::digit_t exponent = e - 1;
+
+    size_t numBits = 0;
+    for( BigNum::digit_t remaining = exponent; remaining != 0; remaining >>= 1 )
+        ++numBits;
+
+    if( numBits == 0 )
+        return;
+
+    load();
+    for( size_t riBit = numBits - 1; riBit > 0; --riBit )
+    {
+        square();
+        if( ((exponent >> (riBit - 1)) & 1) != 0 )
+            multiply();
+    }
+}
+
+// Returns true if e takes the short path.
+inline bool isShortExponent( const BigNum & e )
+{
+    return !e.isZero() && e.numberBits() <= ShortExponentBits;
+}
+
+#endif